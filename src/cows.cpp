@@ -1,1122 +1,4363 @@
-// =================================================================================
-// Solution to maze problem in Scientific American, December 1996:
-// Maze with linked nodes, with arcs labeled 'Yes', 'No', and
-// self-referential rules in the boxes. The goal is to put a 'pencil'
-// in box 1 and one in box 7 then reach a 'goal state' with either
-// one of the pencils.
-// =================================================================================
-
-#include <stdlib.h>
-#include <iostream>
-#include <assert.h>
-
-typedef int BOOL;
-
-static const int TRUE  = 1;
-static const int FALSE = 0;
-
-// =================================================================================
-// Stack tracer size
-// =================================================================================
-
-const int TRACE_ENTRIES = 300;
-
-// =================================================================================
-// Codes for special maze points
-// =================================================================================
-
-const int GOAL_MAZEPOINT        = 100;
-const int ILLEGAL_MAZEPOINT     = 101;
-const int START_PENCIL_0        = 1;
-const int START_PENCIL_1        = 7;
-
-// =================================================================================
-// Codes for paths
-// =================================================================================
-
-const int PATH_YES    = 0; // Yes has been taken (no choice)
-const int PATH_NO     = 1; // No has been taken (no choice)
-const int PATH_LUGNUT = 2; // both Yes & LUGNUT can be taken (choice)
-const int PATH_NONE   = 3; // in case of deadly embrace - no exit
-
-// =================================================================================
-// Codes for maze points
-// =================================================================================
-
-const int MAZEPOINT_COUNT            = 16;
-const int MAZEPOINT[MAZEPOINT_COUNT] = {1,2,5,7,9,15,25,26,35,40,50,55,60,61,65,75};
-
-// =================================================================================
-// Description of a state in the state space: pencil 0 is on some mazepoint, pencil
-// 2 is on some mazepoint, rule 60 is activated (or not), and pencil 0 or pencil 1
-// or both moved in the last round.
-// =================================================================================
-// GetMazePointIndex(int x): Get the index of mazepoint 'x' in the 'MAZEPOINT'
-//                           array. (ILLEGAL_MAZEPOINT & GOAL_MAZEPOINT do not have
-//                           any mazepoint index, of course).
-// Pencil(int pencil):       Get the mazepoint which 'pencil' (0 or 1) is at. This 
-//                           is either a value from the 'MAZEPOINT' array or else
-//                           'ILLEGAL_MAZEPOINT' or 'GOAL_MAZEPOINT'.
-// MovementP(int pencil):    Did 'pencil' move in the last round?
-// Rule60P(void) :           Is rule 60 active?
-// IllegalP(void):           Is this an illegal state (any pencil at
-//                           'ILLEGAL_MAZEPOINT')?
-// GoalP(void):              Is this a goal state (any pencil at 'GOAL_MAZEPOINT')?
-// SetPencil(int p,int mp):  Set pencil 'p' (0 or 1) to mazepoint 'mp'. 'mp' must 
-//                           be either a value from the 'MAZEPOINT' array or else
-//                           'ILLEGAL_MAZEPOINT' or 'GOAL_MAZEPOINT'.
-// SetRule60(BOOL x):        Set or unset rule 60.
-// SetMovement(int p,BOOL x):Record movement for pencil 'p'.
-// =================================================================================
-// Internal:
-// A pencil's position is stored internally as the index into the MAZEPOINT array,
-// except for ILLEGAL_MAZEPOINT and GOAL_MAZEPOINT, which are stored 'as is'.
-// =================================================================================
-
-class State {
-
-private:
-
-  unsigned char pencil[2];
-  unsigned char rule60active;
-  unsigned char pencilMoved[2];
-
-public:
-
-  static int GetMazePointIndex(int mp);
-
-  State(void);
-  State(const State &old);
-  State &operator=(const State &old);
-  ~State(void);
-
-  int  Pencil(int pencil)    const;
-  BOOL MovementP(int pencil) const;
-  BOOL Rule60P(void)         const;
-
-  BOOL IllegalP(void)        const;
-  BOOL GoalP(void)           const;
-
-  void SetPencil(int pencil,int mp);
-  void SetMovement(int pencil,BOOL x);
-  void SetRule60(BOOL x);
-
-};
-
-std::ostream &operator<<(std::ostream &os,const State &s);
-
-// =================================================================================
-// Description of a state transition:
-//
-// Given a 'current state', one can either choose to follow
-// the rule at the maze point given by pencil 0, or one can follow the rule in 
-// the maze point given by pencil 1. In case of a (rare) nondeterministic choice,
-// an alternate state can be the result for pencil 0, or else an alternate state can
-// be the result for pencil 1.
-//
-// Flags indicate whether the alternate states are valid or don't exist.
-//
-// A 'visited' counter tells when the Transition was visited by the
-// state search algorithm (it's 0 if no visit has taken place)
-// =================================================================================
-// SetCurrentState(const State &current):
-//   set the 'current' state (i.e. the state at which this transition may be 
-//   applied). The 'current' state gives the last 3 dimensions of the state space
-//   position.
-// SetNextState(int chosenPencil,const State &next):
-//   set the next state that can be reached by applying the rule pointed to by
-//   pencil 'chosenPencil' (0 or 1), given the 'current' state. The
-//   application of such a rule corresponds to traversal of an arc in the 5-d
-//   state space. 
-// SetAltNextState(int chosenPencil,const State &next):
-//   set the next alternate state that can be reached by applying the rule pointed
-//   to by pencil 'chosenPencil' (0 or 1), given the and 'current' state, in
-//   case of a nondeterministic choice possibility. Calling this function 
-//   automatically sets the 'valid' flag for that alternate state to 'TRUE'.
-// CurrentState(void),NextState(int chosenPencil),
-// AltNextState(int chosenPencil),AltNextValidP(int chosenPencil):
-//   These function retrieve the named states or check whether the alternate 
-//   next states exist.
-// =================================================================================
-
-class Transition {
-
-private:
-
-  State         current;
-  State         next[2];
-  State         altNext[2];
-  int           visited;
-  unsigned char altNextValid[2];
-
-public:
-
-  Transition(void);
-  Transition(const Transition &old);
-  Transition &operator=(const Transition &old);
-  ~Transition(void);
-
-  void  SetCurrentState(const State &current);
-  void  SetNextState(int chosenPencil,const State &next);
-  void  SetAltNextState(int chosenPencil,const State &next);
-  
-  State CurrentState(void)              const;
-  State NextState(int chosenPencil)     const; 
-  State AltNextState(int chosenPencil)  const;
-  BOOL  AltNextValidP(int chosenPencil) const;
-
-  void  SetVisited(int x);
-  int   Visited(void) const;
-
-};
-
-std::ostream &operator<<(std::ostream &os,const Transition &t);
-
-// =================================================================================
-// =================================================================================
-
-class Searcher {
-
-  Transition *space;
-
-  static long TotalStates(void);
-  static long ComputeIndex(const State &current);
-
-  void EnumerateTransitions(void);
-  void DetermineNextStates(int chosenPencil,Transition &trs,int &pathTaken);
-
-  void RecTraverse(long index,int depth,int &maxDepth,State *stackTrace);
-
-  void DumpStackTrace(State *stackTrace,int depth,std::ostream &os);
-
-  static BOOL HasBoxRedTextOrGreenTextP(int x);
-  static BOOL HasBoxGreenTextOrGreenWordP(int x);
-  static BOOL HasBoxRedWordOrGreenWordP(int x);
-  static BOOL HasBoxOddNumberP(int x);
-  static BOOL HasBoxWordWordP(int x);
-  static BOOL HasBoxMultipleOfFiveNumberP(int x);
-  static BOOL DoesBoxReferToCowsP(int x);
-  static int  GetYesPath(int x);
-  static BOOL HasBoxIfSentenceP(int x);
-  
-  // undefined and cannot be called
-
-  Searcher(const Searcher &old);
-  Searcher &operator=(const Searcher &old);
-
-public:
-
-  Searcher(void);
-  ~Searcher(void);
-
-  void StartTraversal(void);
-  void DumpTransitions(std::ostream &os);
-};
-
-// =================================================================================
-// Set everything in motion
-// =================================================================================
-
-int main(void) {
-  Searcher x;
-  x.StartTraversal();
-  x.DumpTransitions(std::cout);
-  return 0;
-}
-
-// =================================================================================
-// Definitions for "State";
-// =================================================================================
-
-int State::GetMazePointIndex(int m) {
-  int i;
-  for (i=0;i<MAZEPOINT_COUNT;i++) {
-    if (MAZEPOINT[i]==m) break;
-  }
-  if (i==MAZEPOINT_COUNT) {
-    std::cerr << "State::GetMazePointIndex(): Illegal maze point value passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  return i;
-}
-
-State::State(void) {
-  pencil[0] = ILLEGAL_MAZEPOINT;
-  pencil[1] = ILLEGAL_MAZEPOINT;
-  pencilMoved[0] = 0;
-  pencilMoved[1] = 0;
-  rule60active = 0;
-}
-
-State::State(const State &old) {
-  (*this) = old;
-}
-
-State &State::operator=(const State &old) {
-  pencil[0] = old.pencil[0];
-  pencil[1] = old.pencil[1];
-  pencilMoved[0] = old.pencilMoved[0];
-  pencilMoved[1] = old.pencilMoved[1];
-  rule60active = old.rule60active;
-  return (*this);
-}
-
-State::~State(void) {
-}
-
-int State::Pencil(int p) const {
-  if (p<0 || 1<p) {
-    std::cerr << "State::Pencil(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  if (pencil[p]==ILLEGAL_MAZEPOINT ||
-      pencil[p]==GOAL_MAZEPOINT) {
-    return pencil[p];
-  }
-  else {
-    return MAZEPOINT[pencil[p]];
-  }
-}
-
-BOOL State::MovementP(int p) const {
-  if (p<0 || 1<p) {
-    std::cerr << "State::MovementP(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  return pencilMoved[p]==1;
-}
-
-BOOL State::Rule60P(void) const {
-  return (rule60active==1);
-}
-
-void State::SetPencil(int p,int x) {
-  if (p<0 || 1<p) {
-    std::cerr << "State::SetPencil(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  if (x==ILLEGAL_MAZEPOINT ||
-      x==GOAL_MAZEPOINT) {
-    pencil[p] = x;
-  }
-  else {
-    pencil[p] = (unsigned char)GetMazePointIndex(x);
-  }
-}
-
-void State::SetMovement(int p,BOOL x) {
-  if (p<0 || 1<p) {
-    std::cerr << "State::SetMovement(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  if (x) pencilMoved[p] = 1; else pencilMoved[p] = 0;
-}
-
-void State::SetRule60(BOOL x) {
-  if (x) rule60active = 1; else rule60active = 0;
-}
-
-BOOL State::IllegalP(void) const {
-  return (pencil[0]==ILLEGAL_MAZEPOINT ||
-          pencil[1]==ILLEGAL_MAZEPOINT);
-}
-
-BOOL State::GoalP(void) const {
-  return (pencil[0]==GOAL_MAZEPOINT ||
-          pencil[1]==GOAL_MAZEPOINT);
-}
-
-std::ostream &operator<<(std::ostream &os,const State &s) {
-  os << "(";
-  if (s.MovementP(0)) os << "m"; else os << ".";
-  if (s.MovementP(1)) os << "m,"; else os << ".,";
-  if (s.Pencil(0)==ILLEGAL_MAZEPOINT) {
-    os << "XX";
-  }
-  else if (s.Pencil(0)==GOAL_MAZEPOINT) {
-    os << "GG";
-  }
-  else {
-    os.width(2);
-    os << s.Pencil(0);
-  }
-  os << ",";
-  if (s.Pencil(1)==ILLEGAL_MAZEPOINT) {
-    os << "XX";
-  }
-  else if (s.Pencil(1)==GOAL_MAZEPOINT) {
-    os << "GG";
-  }
-  else {
-    os.width(2);
-    os << s.Pencil(1);
-  }
-  os << ",";
-  if (s.Rule60P()) os << "*)"; else os << " )";
-  return os;
-}
-
-// =================================================================================
-// Definitions for "Transition"
-// =================================================================================
-
-Transition::Transition(void) {
-  visited         = 0;
-  altNextValid[0] = 0;
-  altNextValid[1] = 0;
-}
-
-Transition::Transition(const Transition &old) {
-  (*this) = old;
-}
-
-Transition &Transition::operator=(const Transition &old) {
-  current = old.current;
-  next[0] = old.next[0];
-  next[1] = old.next[1];
-  altNext[0] = old.altNext[0];
-  altNext[1] = old.altNext[1];
-  altNextValid[0] = old.altNextValid[0];
-  altNextValid[1] = old.altNextValid[1];
-  visited = old.visited;
-  return (*this);
-}
-
-Transition::~Transition(void) {
-}
-  
-void Transition::SetCurrentState(const State &currentIn) {
-  current = currentIn;
-}
-
-void Transition::SetNextState(int chosenPencil,const State &nextIn) {
-  if (chosenPencil<0 || 1<chosenPencil) {
-    std::cerr << "Transition::SetNextState(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  next[chosenPencil] = nextIn;
-}
-
-void Transition::SetAltNextState(int chosenPencil,const State &nextIn) {
-  if (chosenPencil<0 || 1<chosenPencil) {
-    std::cerr << "Transition::SetAltNextState(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  altNext[chosenPencil]      = nextIn;
-  altNextValid[chosenPencil] = 1;
-}
-
-void Transition::SetVisited(int x) {
-  visited = x;
-}
-
-int Transition::Visited(void) const {
-  return visited;
-}
-  
-State Transition::CurrentState(void) const {
-  return current;
-}
-
-State Transition::NextState(int chosenPencil) const {
-  if (chosenPencil<0 || 1<chosenPencil) {
-    std::cerr << "Transition::NextState(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  return next[chosenPencil];
-}
-  
-State Transition::AltNextState(int chosenPencil) const {
-  if (chosenPencil<0 || 1<chosenPencil) {
-    std::cerr << "Transition::AltNextState(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  return altNext[chosenPencil];  
-}
-
-BOOL Transition::AltNextValidP(int chosenPencil) const {
-  if (chosenPencil<0 || 1<chosenPencil) {
-    std::cerr << "Transition::AltNextValidP(): Illegal pencil index passed";
-    std::cerr << std::endl << std::flush;
-    abort();
-  }
-  return altNextValid[chosenPencil];  
-}
-
-std::ostream &operator<<(std::ostream &os,const Transition &t) {
-  State cur  = t.CurrentState();
-  os << cur << " -> ";
-  os << t.NextState(0);
-  if (t.AltNextValidP(0)) {
-    os << " or " << t.AltNextState(0);
-  }
-  os << " (p0) & " << t.NextState(1);
-  if (t.AltNextValidP(1)) {
-    os << " or " << t.AltNextState(1);
-  }
-  os << " (p1) ";
-  if (t.Visited()>0) {
-    os << " visited: " << t.Visited();
-  }
-  return os;
-}
-
-// =================================================================================
-// Definitions for "Searcher"
-// =================================================================================
-
-Searcher::Searcher(void) {
-  std::cerr << "Allocating state space..." << std::endl << std::flush;
-  space = new Transition[TotalStates()];
-  if (space==NULL) {
-    std::cerr << "Not enough memory" << std::endl << std::flush;
-    abort();
-  }
-  EnumerateTransitions();
-}
-
-Searcher::~Searcher(void) {
-  delete[] space;
-}
-
-long Searcher::TotalStates(void) {
-  // This yields the total number of states to check out;
-  // a point in the state space is given by the position
-  // of pencil 0, the position of pencil 1 and two booleans
-  // indicating whether pencil 0 or pencil 1 moved in the
-  // last round and the state of rule 60. That's all the
-  // information one needs.
-  // If one did not want to distinguish state pencil positions
-  // (7,1) and (1,7) for example, one could half the
-  // state space. But it's not sure whether this is 
-  // desirable...
-  // Thus we consider:
-  long result = (long)MAZEPOINT_COUNT *  // pencil 0
-                (long)MAZEPOINT_COUNT *  // pencil 1
-                2 *                      // pencil 0 movement
-                2 *                      // pencil 1 movement
-                2;                       // rule 60 active
-  return result;
-}
-
-long Searcher::ComputeIndex(const State &current) {
-  long result = 0;
-  // this yields the index of the state array
-  //
-  // pencil 0,movement indexing ... range is 2
-  result = result * 2;
-  if (current.MovementP(0)) result++;
-  // pencil 1,movement indexing ... range is 2
-  result = result * 2;
-  if (current.MovementP(1)) result++;
-  // pencil 0,current indexing ... range is MAZEPOINT_COUNT; result is first
-  // multiplied by the current range
-  result = result * (long)MAZEPOINT_COUNT ;
-  result = result + (long)State::GetMazePointIndex(current.Pencil(0));
-  // pencil 1,current indexing ... range is MAZEPOINT_COUNT; result is first
-  // multiplied by the current range
-  result = result * (long)MAZEPOINT_COUNT ;
-  result = result + (long)State::GetMazePointIndex(current.Pencil(1));
-  // rule60,current boolean indexing ... range is 2; result is first
-  // multiplied by the current range
-  result = result * 2;
-  if (current.Rule60P()) result++;
-  return result;
-}
-
-void Searcher::EnumerateTransitions(void) {
-  BOOL pencil0mv=TRUE;
-  do {
-    BOOL pencil1mv=TRUE;
-    do {
-      for (int curP0=0;curP0<MAZEPOINT_COUNT;curP0++) {
-        for (int curP1=0;curP1<MAZEPOINT_COUNT;curP1++) {
-          BOOL curR60=TRUE;
-          do {
-            State current;
-            current.SetPencil(0,MAZEPOINT[curP0]);
-            current.SetPencil(1,MAZEPOINT[curP1]);
-            current.SetRule60(curR60);
-            current.SetMovement(0,pencil0mv);
-            current.SetMovement(1,pencil1mv);
-            {
-              long index = ComputeIndex(current);
-              assert(index<TotalStates());
-	            space[index].SetCurrentState(current);
-              // compute next states
-              int pathTaken;
-              DetermineNextStates(0,space[index],pathTaken);
-              DetermineNextStates(1,space[index],pathTaken);
-            }
-            curR60=!curR60;
-          } while (!curR60);
-        }
-      }
-      pencil1mv = !pencil1mv;
-    } while (!pencil1mv);
-    pencil0mv = !pencil0mv;
-  } while (!pencil0mv);
-}
-
-void Searcher::DumpTransitions(std::ostream &os) {
-  BOOL pencil0mv=TRUE;
-  do {
-    BOOL pencil1mv=TRUE;
-    do {
-      for (int curP0=0;curP0<MAZEPOINT_COUNT;curP0++) {
-        for (int curP1=0;curP1<MAZEPOINT_COUNT;curP1++) {
-          BOOL curR60=TRUE;
-          do {
-            State current;
-            current.SetPencil(0,MAZEPOINT[curP0]);
-            current.SetPencil(1,MAZEPOINT[curP1]);
-            current.SetRule60(curR60);
-            current.SetMovement(0,pencil0mv);
-            current.SetMovement(1,pencil1mv);
-            long index = ComputeIndex(current);
-            assert(index<TotalStates());
-            if (space[index].Visited()>0) {
-	            os << space[index] << std::endl << std::flush;
-            }
-            curR60=!curR60;
-          } while (!curR60);
-        }
-      }
-      pencil1mv = !pencil1mv;
-    } while (!pencil1mv);
-    pencil0mv = !pencil0mv;
-  } while (!pencil0mv);
-}
-
-void Searcher::DumpStackTrace(State *stackTrace,int depth,std::ostream &os) {
-  if (depth>37) return;
-  os << "---- Stack trace, depth " << depth << std::endl;
-  for (int i=0;i<depth;i++) {
-    os << stackTrace[i] << std::endl;
-  }
-}
-
-// ---------------------------------------------------------------------------------
-// Various decisions
-// ---------------------------------------------------------------------------------
-
-BOOL Searcher::HasBoxRedTextOrGreenTextP(int x) {
-  return (x==7  || x==26 || x==61 || x==25 ||
-          x==50 || x==60 || x==9  || x==40);
-}
-
-BOOL Searcher::HasBoxGreenTextOrGreenWordP(int x) {
-  return (x==60 || x==5  || x==25 || x==2 ||
-          x==65 || x==40 || x==1);
-}
-
-BOOL Searcher::HasBoxRedWordOrGreenWordP(int x) {
-  return (x==5 || x==25  || x==2 || x==60 ||
-          x==1 || x==40  || x==65);
-}
-
-BOOL Searcher::HasBoxOddNumberP(int x) {
-  return (x%2==1);
-}
-
-BOOL Searcher::HasBoxWordWordP(int x) {
-  return (x==35 || x==5);
-}
-
-BOOL Searcher::HasBoxMultipleOfFiveNumberP(int x) {
-  return (x%5==0);
-}
-
-BOOL Searcher::DoesBoxReferToCowsP(int x) {
-  return x==50;
-}
-
-int Searcher::GetYesPath(int x) {
-  switch (x) {
-  case 1:  return 2;
-  case 2:  return 7;
-  case 5:  return 25;
-  case 7:  return 26;
-  case 9:  return 2;
-  case 15: return 5;
-  case 25: return 7;
-  case 26: return 61;
-  case 35: return 40;
-  case 40: return 65;
-  case 50: return GOAL_MAZEPOINT;
-  case 55: return 15;
-  case 60: return 25;
-  case 61: return 1;
-  case 65: return 75;
-  case 75: return 1;
-  default:
-    std::cerr << "GetYesPath(): No such state!" << std::endl << std::flush;
-    abort();
-    return 0; // keeps compiler happy
-  }
-}
-
-BOOL Searcher::HasBoxIfSentenceP(int x) {
-  return (x==61 || x==26 || x==65);
-}
-
-// ---------------------------------------------------------------------------------
-// Determine the 'next states' for the passed transition if the rule in the box of
-// 'chosenPencil' is considered. 'pathTaken' will take a code telling whether
-// 'YES', 'NO' or 'LUGNUT' (in the single nondeterministic choice) has been
-// taken
-// ---------------------------------------------------------------------------------
-
-void Searcher::DetermineNextStates(int chosenPencil,Transition &trs,int &pathTaken) {
-  State current     = trs.CurrentState();
-  State next        = current;
-  State altNext     = current;
-  next.SetMovement(0,FALSE);
-  next.SetMovement(1,FALSE);
-  int   otherPencil = (chosenPencil+1)%2;
-  if (current.IllegalP() || current.GoalP()) {
-    std::cerr << "Searcher::DetermineNextStates(): not a normal current state" << std::endl << std::flush;
-    abort();
-  }
-  switch (current.Pencil(chosenPencil)) {
-  case 1:
-    // Box 1:
-    // "Does the other pencil point to a box that has either red
-    //  text or green text?"
-    // Yes -> Box 2
-    // No  -> Box 9
-    if (HasBoxRedTextOrGreenTextP(current.Pencil(otherPencil))) {
-      next.SetPencil(chosenPencil,2);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      next.SetPencil(chosenPencil,9);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_NO;
-    }
-    break;
-  case 2:
-    // Box 2:
-    // "Does the other pencil point to a box that has green text
-    // or has the word "green"?
-    // Yes -> Box 7
-    // No  -> Box 15
-    if (HasBoxGreenTextOrGreenWordP(current.Pencil(otherPencil))) {
-      next.SetPencil(chosenPencil,7);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      next.SetPencil(chosenPencil,15);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_NO;
-    }
-    break;
-  case 5:
-    // Box 5:
-    // "Does the other pencil point to text that has the word "red" or 
-    // the word "green"?
-    // Yes -> Box 25
-    // No  -> Box 2
-    if (HasBoxRedWordOrGreenWordP(current.Pencil(otherPencil))) {
-      next.SetPencil(chosenPencil,25);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      next.SetPencil(chosenPencil,2);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_NO;
-    }
-    break;
-  case 7:
-    // Box 7: (red text)
-    // "Is the other pencil in a box whose number is an odd number?"
-    // Yes -> Box 26
-    // No  -> Box 5
-    if (current.Rule60P()) {
-      // ignore red text, just move through 'Yes'
-      next.SetPencil(chosenPencil,26);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      // work off rule as usual
-      if (HasBoxOddNumberP(current.Pencil(otherPencil))) {
-        next.SetPencil(chosenPencil,26);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_YES;
-      }
-      else {
-        next.SetPencil(chosenPencil,5);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_NO;
-      }
-    }
-    break;
-  case 9:
-    // Box 9: (red text)
-    // "On the last turn, did you move the other pencil?"
-    // Yes -> 2
-    // No  -> 35
-    if (current.Rule60P()) {
-      // ignore red text, just move through 'Yes'
-      next.SetPencil(chosenPencil,2);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      // work off rule as usual
-      if (current.MovementP(otherPencil)) {
-        next.SetPencil(chosenPencil,2);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_YES;
-      }
-      else {
-        next.SetPencil(chosenPencil,35);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_NO;
-      }
-    }
-    break;
-  case 15:
-    // Box 15: 
-    // "Is the other pencil in a box whose number is evenly divisible by 5?"
-    // Yes -> 5
-    // No  -> 40
-    if (HasBoxMultipleOfFiveNumberP(current.Pencil(otherPencil))) {
-      next.SetPencil(chosenPencil,5);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      next.SetPencil(chosenPencil,40);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_NO;
-    }
-    break;
-  case 25:
-    // Box 25: (red text)
-    // "Does the other pencil point to a box that has either
-    //  red text or green text?"
-    // Yes -> 7
-    // No  -> 50
-    if (current.Rule60P()) {
-      // ignore red text, just move through 'Yes'
-      next.SetPencil(chosenPencil,7);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      // work off rule as usual
-      if (HasBoxRedTextOrGreenTextP(current.Pencil(otherPencil))) {
-        next.SetPencil(chosenPencil,7);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_YES;
-      }
-      else {
-        next.SetPencil(chosenPencil,50);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_NO;
-      }
-    }
-    break;
-  case 26:
-    // Box 26: (red text)
-    // "If you had chosen the other pencil, would it exit on a
-    // path marked "NO"?"
-    // Yes -> 61
-    // No  -> 55
-    if (current.Rule60P()) {
-      // ignore red text, just move through 'Yes'
-      next.SetPencil(chosenPencil,61);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      // work off rule as usual
-      // this is a recursive call, which need not be feasible
-      if (current.Pencil(otherPencil)==26) {
-        // deadly embrace
-        next.SetPencil(chosenPencil,ILLEGAL_MAZEPOINT);
-        next.SetPencil(otherPencil,ILLEGAL_MAZEPOINT);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_NONE;
-      }
-      else {
-        // call the function recursively on a temporary transition
-        int        otherPath;
-        Transition tmp = trs;
-        DetermineNextStates(otherPencil,tmp,otherPath);
-        if (otherPath==PATH_NO) {
-          next.SetPencil(chosenPencil,61);
-          next.SetMovement(chosenPencil,TRUE);
-          trs.SetNextState(chosenPencil,next);
-          pathTaken = PATH_YES;
-        }
-        else {
-          next.SetPencil(chosenPencil,55);
-          next.SetMovement(chosenPencil,TRUE);
-          trs.SetNextState(chosenPencil,next);
-          pathTaken = PATH_NO;
-        }
-      }
-    }
-    break;
-  case 35:
-    // Box 35:
-    // "Does the other pencil point to text that has the word "word"?
-    // Yes -> 40
-    // No  -> 1
-    if (HasBoxWordWordP(current.Pencil(otherPencil))) {
-      next.SetPencil(chosenPencil,40);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      next.SetPencil(chosenPencil,1);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_NO;
-    }
-    break;
-  case 40:
-    // Box 40: (red text)
-    // "Is the text in this box green?" (this is a question about rule 60,i.e.
-    // it prepares toggling rule 60)
-    // Yes -> 65
-    // No  -> 60
-    if (current.Rule60P()) {
-      // ignore red text, just move through 'Yes'
-      next.SetPencil(chosenPencil,65);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      // work off rule as usual
-      next.SetPencil(chosenPencil,60);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_NO;
-    }
-    break;
-  case 50:
-    // Box 50: (red text)
-    // "Does the other pencil point to text that refers to cows?"
-    // Yes -> GOAL
-    // No  -> 26
-    if (current.Rule60P()) {
-      // ignore red text, just move through 'Yes'
-      next.SetPencil(chosenPencil,GOAL_MAZEPOINT);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      // work off rule as usual
-      if (DoesBoxReferToCowsP(current.Pencil(otherPencil))) {
-        next.SetPencil(chosenPencil,GOAL_MAZEPOINT);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_YES;
-      }
-      else {
-        next.SetPencil(chosenPencil,26);
-        next.SetMovement(chosenPencil,TRUE);
-        trs.SetNextState(chosenPencil,next);
-        pathTaken = PATH_NO;
-      }
-    }
-    break;
-  case 55:
-    // Box 55:
-    // "Free choice: Exit either on the path marked "Yes" or on the
-    //  path marked "LUGNUT""
-    // Yes    -> 15
-    // Lugnut -> 7
-    // ...this means an alternate state comes on
-    next.SetPencil(chosenPencil,15);
-    next.SetMovement(chosenPencil,TRUE);
-    trs.SetNextState(chosenPencil,next);
-    next.SetPencil(chosenPencil,7);
-    trs.SetAltNextState(chosenPencil,next);
-    pathTaken = PATH_LUGNUT;
-    break;
-  case 60:
-    // Box 60: (green text)
-    // "Until further notice, make this change in the rules: If you choose
-    //  a pencil that points to a red text, ignore what the text says. Just exit
-    //  on the path marked "yes". Now exit from this box on the path marked
-    //  "Yes"".
-    // Yes -> 25
-    next.SetPencil(chosenPencil,25);
-    next.SetMovement(chosenPencil,TRUE);
-    next.SetRule60(TRUE);
-    trs.SetNextState(chosenPencil,next);
-    pathTaken = PATH_YES;
-    break;
-  case 61:
-    // Box 61: (red text)
-    // "If you choose this box, ignore the text the other pencil points to.
-    //  Move the other pencil on the path marked "Yes". Then move this 
-    //  pencil on the path marked "yes".
-    // Yes -> 1
-    if (current.Rule60P()) {
-      // ignore red text, just move through 'Yes'
-      next.SetPencil(chosenPencil,1);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      // work off rule as usual
-      next.SetPencil(chosenPencil,1);
-      next.SetMovement(chosenPencil,TRUE);
-      next.SetPencil(otherPencil,GetYesPath(current.Pencil(otherPencil)));
-      next.SetMovement(otherPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    break;
-  case 65:
-    // Box 65:
-    // "If the rule stated in green in Box 60 is now in effect, cancel
-    //  that rule. Until further notice, when you choose a box with red
-    //  text, follow what the text says. Now exit from this box on the
-    //  path marked "Yes"."
-    // Yes -> 75
-    next.SetPencil(chosenPencil,75);
-    next.SetRule60(FALSE);
-    next.SetMovement(chosenPencil,TRUE);
-    trs.SetNextState(chosenPencil,next);
-    pathTaken = PATH_YES;
-    break;
-  case 75:
-    // Box 75:
-    // "Does the other pencil point to text that begins "If"?"
-    // Yes -> 1
-    // No  -> 50
-    if (HasBoxIfSentenceP(current.Pencil(otherPencil))) {
-      next.SetPencil(chosenPencil,1);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_YES;
-    }
-    else {
-      next.SetPencil(chosenPencil,50);
-      next.SetMovement(chosenPencil,TRUE);
-      trs.SetNextState(chosenPencil,next);
-      pathTaken = PATH_NO;
-    }
-    break;
-  default:
-    std::cerr << "Searcher::DetermineNextStates(): No such state" << std::endl << std::flush;
-    abort();
-  }
-}
-
-// ---------------------------------------------------------------------------------
-// Recursively traverse the state space
-// ---------------------------------------------------------------------------------
-
-void Searcher::StartTraversal(void) {
-  // allocate a stack tracer of TRACE_ENTRIES entries (empirical result, otherwise
-  // a linked list would have to be created)
-  State *stackTrace = new State[TRACE_ENTRIES];
-  if (stackTrace==NULL) {
-    std::cerr << "Out of memory" << std::endl << std::flush;
-    abort();
-  }
-  // searching may start
-  State start;
-  int  maxDepth = 0;
-  start.SetPencil(0,START_PENCIL_0);
-  start.SetPencil(1,START_PENCIL_1);
-  RecTraverse(ComputeIndex(start),1,maxDepth,stackTrace);
-  std::cout << "The maximal search depth encountered is " << maxDepth << std::endl << std::flush;
-  delete[] stackTrace;
-}
-
-void Searcher::RecTraverse(long index,int depth,int &maxDepth,State *stackTrace) {
-  if (space[index].Visited()>0 && space[index].Visited()<=depth) {
-    // we have been here earlier
-    return;
-  }
-  else {
-    // store the current depth here
-    space[index].SetVisited(depth);
-    // record a maximal depth value
-    if (maxDepth<depth) maxDepth=depth;
-    // record the current state
-    if (depth<=TRACE_ENTRIES) {
-      stackTrace[depth-1] = space[index].CurrentState();
-    }
-    // test all possible movements from here...
-    for (int pencil=0;pencil<2;pencil++) {
-      if (space[index].NextState(pencil).IllegalP()) {
-        // no use continuing
-        std::cerr << "Illegal state encountered!" << std::endl << std::flush;
-        return;
-      }
-      else if (space[index].NextState(pencil).GoalP()) {
-        // no use continuing
-        std::cerr << "Goal state encountered at " << depth << "!" << std::endl << std::flush;
-        // dump this
-        DumpStackTrace(stackTrace,depth,std::cout);
-        return;
-      }
-      else {
-        long nextState = ComputeIndex(space[index].NextState(pencil));  
-        RecTraverse(nextState,depth+1,maxDepth,stackTrace);
-      }
-      if (space[index].AltNextValidP(pencil)) {
-        if (space[index].AltNextState(pencil).IllegalP()) {
-          // no use continuing
-          std::cerr << "Illegal state encountered!" << std::endl << std::flush;
-          return;
-        }
-        else if (space[index].AltNextState(pencil).GoalP()) {
-          // no use continuing
-          std::cerr << "Goal state encountered at " << depth << "!" << std::endl << std::flush;
-          // dump this
-          DumpStackTrace(stackTrace,depth,std::cout);
-          return;
-        }
-        else {
-         long altNextState = ComputeIndex(space[index].AltNextState(pencil));  
-         RecTraverse(altNextState,depth+1,maxDepth,stackTrace);
-        }
-      }
-    }
-  }
-}
+// =================================================================================
+// Solution to maze problem in Scientific American, December 1996:
+// Maze with linked nodes, with arcs labeled 'Yes', 'No', and
+// self-referential rules in the boxes. The goal is to put a 'pencil'
+// in box 1 and one in box 7 then reach a 'goal state' with either
+// one of the pencils.
+// =================================================================================
+
+#include "cows.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/time.h>
+#include <signal.h>
+#include <errno.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include <new>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <condition_variable>
+
+// =================================================================================
+// Definitions for "Maze"
+// =================================================================================
+
+const Maze *Maze::current = NULL;
+
+// the names used in maze description files, in the order of the bits or codes
+
+const int   PROPERTY_NAME_COUNT = 9;
+const char *PROPERTY_NAME[PROPERTY_NAME_COUNT] = {
+  "red-text","green-text","word-red","word-green","word-word","refers-to-cows",
+  "if-sentence","odd-number","multiple-of-five"
+};
+
+const int   EFFECT_NAME_COUNT = 5;
+const char *EFFECT_NAME[EFFECT_NAME_COUNT] = {
+  "set-rule60","clear-rule60","move-other","set-flag","clear-flag"
+};
+
+const int   RULE_NAME_COUNT = 7;
+const char *RULE_NAME[RULE_NAME_COUNT] = {
+  "other-has","self-has","other-moved","counterfactual","choice","always","flag-set"
+};
+
+Maze::Maze(void) {
+  boxCount   = MAZEPOINT_COUNT;
+  rules      = new BoxRule[MAZEPOINT_COUNT];
+  properties = NULL;
+  index      = NULL;
+  otherYes   = NULL;
+  yesWords   = 0;
+  otherMask  = NULL;
+  maxNumber  = -1;
+  pencilCount = 2;
+  flagCount   = 1;
+  start[0]   = START_PENCIL_0;
+  start[1]   = START_PENCIL_1;
+  memcpy(rules,MAZE_RULES,sizeof(MAZE_RULES));
+  // the built-in maze is consistent (see the static_asserts), this cannot fail
+  if (!Finish("built-in maze",std::cerr)) abort();
+}
+
+Maze::Maze(const BoxRule *rulesIn,int boxCountIn,int pencilCountIn,int flagCountIn,const int *startIn) {
+  boxCount    = (boxCountIn<0) ? 0 : boxCountIn;
+  rules       = new BoxRule[boxCount+1];
+  properties  = NULL;
+  index       = NULL;
+  otherYes    = NULL;
+  yesWords    = 0;
+  otherMask   = NULL;
+  maxNumber   = -1;
+  pencilCount = pencilCountIn;
+  flagCount   = flagCountIn;
+  memcpy(rules,rulesIn,boxCount*sizeof(BoxRule));
+  for (int p=0;p<MAX_PENCILS;p++) {
+    start[p] = (p<pencilCount) ? startIn[p] : -1;
+  }
+}
+
+Maze::~Maze(void) {
+  Clear();
+}
+
+void Maze::Clear(void) {
+  if (current==this) current = NULL;
+  delete[] rules;
+  delete[] properties;
+  delete[] index;
+  delete[] otherYes;
+  delete[] otherMask;
+  boxCount   = 0;
+  rules      = NULL;
+  properties = NULL;
+  index      = NULL;
+  otherYes   = NULL;
+  yesWords   = 0;
+  otherMask  = NULL;
+  maxNumber  = -1;
+}
+
+// ---------------------------------------------------------------------------------
+// Set bit i of 'bits' ((count+63)/64 words) if box i of 'count' boxes with
+// property words 'properties' has any of the properties in 'mask'. The boxes
+// are done 8 at a time with AVX2 or 4 at a time with SSE2 where the compiler
+// targets them (AVX2 e.g. with -mavx2), one at a time otherwise, with the same
+// result.
+// ---------------------------------------------------------------------------------
+
+static void MaskColumn(const unsigned *properties,int count,unsigned mask,unsigned long long *bits) {
+  int i = 0;
+  memset(bits,0,((count+63)/64)*sizeof(unsigned long long));
+#if defined(__AVX2__)
+  const __m256i wanted = _mm256_set1_epi32((int)mask);
+  for (;i+8<=count;i+=8) {
+    __m256i  p    = _mm256_loadu_si256((const __m256i *)(properties+i));
+    __m256i  none = _mm256_cmpeq_epi32(_mm256_and_si256(p,wanted),_mm256_setzero_si256());
+    unsigned hit  = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(none)) & 0xFFu;
+    bits[i>>6] |= (unsigned long long)hit<<(i&63);
+  }
+#elif defined(__SSE2__)
+  const __m128i wanted = _mm_set1_epi32((int)mask);
+  for (;i+4<=count;i+=4) {
+    __m128i  p    = _mm_loadu_si128((const __m128i *)(properties+i));
+    __m128i  none = _mm_cmpeq_epi32(_mm_and_si128(p,wanted),_mm_setzero_si128());
+    unsigned hit  = ~(unsigned)_mm_movemask_ps(_mm_castsi128_ps(none)) & 0xFu;
+    bits[i>>6] |= (unsigned long long)hit<<(i&63);
+  }
+#endif
+  for (;i<count;i++) {
+    if (properties[i] & mask) bits[i>>6] |= 1ULL<<(i&63);
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Check the boxes in 'rules', derive the number properties and build the lookup
+// table from box numbers to box indexes and the rule table (see OtherYesP()).
+// 'name' is used in the error messages.
+// ---------------------------------------------------------------------------------
+
+BOOL Maze::Finish(const char *name,std::ostream &err) {
+  delete[] properties;
+  delete[] index;
+  delete[] otherYes;
+  delete[] otherMask;
+  properties = NULL;
+  index      = NULL;
+  otherYes   = NULL;
+  yesWords   = 0;
+  otherMask  = NULL;
+  maxNumber  = -1;
+  if (boxCount==0) {
+    err << name << ": no boxes" << std::endl << std::flush;
+    return FALSE;
+  }
+  if (pencilCount<2 || MAX_PENCILS<pencilCount || flagCount<1 || MAX_FLAGS<flagCount) {
+    err << name << ": between 2 and " << MAX_PENCILS << " pencils and between 1 and "
+        << MAX_FLAGS << " flags are supported" << std::endl << std::flush;
+    return FALSE;
+  }
+  for (int i=0;i<boxCount;i++) {
+    if (rules[i].number<0) {
+      err << name << ": negative box number " << rules[i].number << std::endl << std::flush;
+      return FALSE;
+    }
+    if (rules[i].kind<0 || RULE_NAME_COUNT<=rules[i].kind) {
+      err << name << ": box " << rules[i].number << " has no valid rule" << std::endl << std::flush;
+      return FALSE;
+    }
+    if (rules[i].flag<0 || flagCount<=rules[i].flag) {
+      err << name << ": box " << rules[i].number << " refers to unknown flag " << rules[i].flag << std::endl << std::flush;
+      return FALSE;
+    }
+    if (maxNumber<rules[i].number) maxNumber = rules[i].number;
+  }
+  index = new int[maxNumber+1];
+  for (int x=0;x<=maxNumber;x++) index[x] = -1;
+  properties = new unsigned[boxCount];
+  for (int i=0;i<boxCount;i++) {
+    if (index[rules[i].number]>=0) {
+      err << name << ": box " << rules[i].number << " is defined twice" << std::endl << std::flush;
+      return FALSE;
+    }
+    index[rules[i].number] = i;
+    properties[i] = rules[i].properties;
+    if (rules[i].number%2==1) properties[i] |= PROP_ODD_NUMBER;
+    if (rules[i].number%5==0) properties[i] |= PROP_MULTIPLE_OF_FIVE;
+  }
+  for (int i=0;i<boxCount;i++) {
+    const int targets[2] = { rules[i].yes,rules[i].no };
+    for (int t=0;t<2;t++) {
+      int x = targets[t];
+      if (x!=GOAL_MAZEPOINT && (x<0 || maxNumber<x || index[x]<0)) {
+        err << name << ": box " << rules[i].number << " leads to unknown box " << x << std::endl << std::flush;
+        return FALSE;
+      }
+    }
+  }
+  for (int p=0;p<pencilCount;p++) {
+    if (start[p]<0 || maxNumber<start[p] || index[start[p]]<0) {
+      err << name << ": pencil " << p << " starts in unknown box " << start[p] << std::endl << std::flush;
+      return FALSE;
+    }
+  }
+  if (IndexBits(boxCount,pencilCount,flagCount)>STATE_MAX_INDEX_BITS) {
+    err << name << ": too many boxes for this number of pencils and flags" << std::endl << std::flush;
+    return FALSE;
+  }
+  yesWords  = (boxCount+63)/64;
+  otherYes  = new unsigned long long[(long)boxCount*yesWords];
+  otherMask = new unsigned[boxCount];
+  for (int i=0;i<boxCount;i++) {
+    otherMask[i] = (rules[i].kind==RULE_OTHER_HAS) ? rules[i].mask : 0;
+    MaskColumn(properties,boxCount,otherMask[i],otherYes+(long)i*yesWords);
+  }
+  return TRUE;
+}
+
+BOOL Maze::Load(const char *fileName,std::ostream &err) {
+  std::ifstream is(fileName);
+  if (!is) {
+    err << fileName << ": cannot be opened" << std::endl << std::flush;
+    return FALSE;
+  }
+  return Parse(is,fileName,err);
+}
+
+// ---------------------------------------------------------------------------------
+// Helpers for Parse(): look up a name in one of the name tables, or a
+// comma-separated list of names giving a bit set. Return FALSE if a name is
+// unknown.
+// ---------------------------------------------------------------------------------
+
+static BOOL LookupName(const std::string &word,const char **names,int count,int &code) {
+  for (int i=0;i<count;i++) {
+    if (word==names[i]) {
+      code = i;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static BOOL LookupNameList(const std::string &list,const char **names,int count,unsigned &bits) {
+  bits = 0;
+  std::string::size_type from = 0;
+  while (from<=list.size()) {
+    std::string::size_type to = list.find(',',from);
+    if (to==std::string::npos) to = list.size();
+    int code;
+    if (!LookupName(list.substr(from,to-from),names,count,code)) return FALSE;
+    bits |= 1u<<code;
+    from = to+1;
+  }
+  return TRUE;
+}
+
+static BOOL ParseTarget(const std::string &word,int &target) {
+  if (word=="goal") {
+    target = GOAL_MAZEPOINT;
+    return TRUE;
+  }
+  char *end;
+  long  x = strtol(word.c_str(),&end,10);
+  if (word.empty() || *end!='\0' || x<0 || 0x7FFFFFFFL<x) return FALSE;
+  target = (int)x;
+  return TRUE;
+}
+
+// the rest of a "box" line, after the word "box"
+static BOOL ParseBox(std::istream &words,BoxRule &rule) {
+  std::string number,kind,word;
+  memset(&rule,0,sizeof(rule));
+  BOOL ok = (words >> number >> kind) && ParseTarget(number,rule.number) && rule.number!=GOAL_MAZEPOINT &&
+            LookupName(kind,RULE_NAME,RULE_NAME_COUNT,rule.kind);
+  if (ok && (rule.kind==RULE_OTHER_HAS || rule.kind==RULE_SELF_HAS)) {
+    std::string mask;
+    ok = (words >> mask) && LookupNameList(mask,PROPERTY_NAME,PROPERTY_NAME_COUNT,rule.mask);
+  }
+  BOOL haveYes = FALSE;
+  BOOL haveNo  = FALSE;
+  while (ok && (words >> word)) {
+    std::string arg;
+    ok = !(words >> arg).fail();
+    if (!ok) break;
+    if (word=="yes") {
+      ok = ParseTarget(arg,rule.yes);
+      haveYes = TRUE;
+    }
+    else if (word=="no") {
+      ok = ParseTarget(arg,rule.no);
+      haveNo = TRUE;
+    }
+    else if (word=="effects") {
+      ok = LookupNameList(arg,EFFECT_NAME,EFFECT_NAME_COUNT,rule.effects);
+    }
+    else if (word=="text") {
+      ok = LookupNameList(arg,PROPERTY_NAME,PROPERTY_NAME_COUNT,rule.properties);
+    }
+    else if (word=="flag") {
+      ok = ParseTarget(arg,rule.flag) && rule.flag!=GOAL_MAZEPOINT;
+    }
+    else {
+      ok = FALSE;
+    }
+  }
+  // "always" has no 'no' exit, it takes the 'yes' one
+  if (ok && !haveNo && rule.kind==RULE_ALWAYS) {
+    rule.no = rule.yes;
+    haveNo  = TRUE;
+  }
+  return ok && haveYes && haveNo;
+}
+
+BOOL Maze::Parse(std::istream &is,const char *name,std::ostream &err) {
+  std::vector<BoxRule> boxes;
+  int                  startIn[MAX_PENCILS];
+  int                  pencilsIn  = 0;
+  int                  flagsIn    = 1;
+  BOOL                 started    = FALSE;
+  BOOL                 flagged    = FALSE;
+  std::string          line;
+  int                  lineNumber = 0;
+  while (std::getline(is,line)) {
+    lineNumber++;
+    std::string::size_type hash = line.find('#');
+    if (hash!=std::string::npos) line.erase(hash);
+    std::istringstream words(line);
+    std::string        word;
+    if (!(words >> word)) continue;
+    BOOL ok = TRUE;
+    if (word=="start") {
+      ok = !started;
+      while (ok && (words >> word)) {
+        ok = pencilsIn<MAX_PENCILS && ParseTarget(word,startIn[pencilsIn]) &&
+             startIn[pencilsIn]!=GOAL_MAZEPOINT;
+        pencilsIn++;
+      }
+      ok = ok && pencilsIn>=2;
+      started = TRUE;
+    }
+    else if (word=="flags") {
+      ok = !flagged && (words >> flagsIn) && 1<=flagsIn && flagsIn<=MAX_FLAGS && !(words >> word);
+      flagged = TRUE;
+    }
+    else if (word=="box") {
+      BoxRule rule;
+      ok = ParseBox(words,rule);
+      boxes.push_back(rule);
+    }
+    else {
+      ok = FALSE;
+    }
+    if (!ok) {
+      err << name << ":" << lineNumber << ": syntax error" << std::endl << std::flush;
+      return FALSE;
+    }
+  }
+  if (!started) {
+    err << name << ": no start line" << std::endl << std::flush;
+    return FALSE;
+  }
+  Clear();
+  boxCount = (int)boxes.size();
+  rules    = new BoxRule[boxCount+1];
+  for (int i=0;i<boxCount;i++) rules[i] = boxes[i];
+  pencilCount = pencilsIn;
+  flagCount   = flagsIn;
+  for (int p=0;p<pencilCount;p++) start[p] = startIn[p];
+  return Finish(name,err);
+}
+
+BOOL Maze::Edit(const std::string &line,const char *name,std::ostream &err,int &edited) {
+  std::string::size_type hash = line.find('#');
+  std::istringstream     words(line.substr(0,hash));
+  std::string            word;
+  BoxRule                rule;
+  if (!(words >> word) || word!="box" || !ParseBox(words,rule)) {
+    err << name << ": syntax error" << std::endl << std::flush;
+    return FALSE;
+  }
+  if (!BoxP(rule.number)) {
+    err << name << ": there is no box " << rule.number << " to edit" << std::endl << std::flush;
+    return FALSE;
+  }
+  edited = index[rule.number];
+  BoxRule old = rules[edited];
+  rules[edited] = rule;
+  if (!Finish(name,err)) {
+    rules[edited] = old;
+    Finish(name,err);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// the difference of the box numbers of consecutive copies in a chained maze, a
+// multiple of 10 so that oddness and being a multiple of five are kept
+const int CHAIN_OFFSET = 100;
+
+BOOL Maze::Chain(const Maze &base,int copies,int pencils,std::ostream &err) {
+  std::ostringstream name;
+  name << copies << " chained copies";
+  if (copies<1 || base.maxNumber>=CHAIN_OFFSET ||
+      (long)copies*CHAIN_OFFSET>INT_MAX || copies>INT_MAX/base.boxCount) {
+    err << name.str() << ": cannot chain that many copies of the maze" << std::endl << std::flush;
+    return FALSE;
+  }
+  int      total   = copies*base.boxCount;
+  BoxRule *chained = new BoxRule[total+1];
+  for (int c=0;c<copies;c++) {
+    int offset = c*CHAIN_OFFSET;
+    int next   = (c+1<copies) ? base.rules[0].number+offset+CHAIN_OFFSET : GOAL_MAZEPOINT;
+    for (int i=0;i<base.boxCount;i++) {
+      BoxRule &rule = chained[c*base.boxCount+i];
+      rule         = base.rules[i];
+      rule.number += offset;
+      rule.yes     = (rule.yes==GOAL_MAZEPOINT) ? next : rule.yes+offset;
+      rule.no      = (rule.no==GOAL_MAZEPOINT)  ? next : rule.no+offset;
+    }
+  }
+  Clear();
+  boxCount    = total;
+  rules       = chained;
+  pencilCount = pencils;
+  flagCount   = base.flagCount;
+  for (int p=0;p<pencils && p<MAX_PENCILS;p++) {
+    start[p] = (p<base.pencilCount) ? base.start[p]
+                                    : base.rules[(p-base.pencilCount+1)%base.boxCount].number;
+  }
+  return Finish(name.str().c_str(),err);
+}
+
+// ---------------------------------------------------------------------------------
+// Random numbers for Generate(): SplitMix64, which gives the same sequence for a
+// seed on every platform (unlike the distributions of <random>)
+// ---------------------------------------------------------------------------------
+
+static unsigned long long NextRandom(unsigned long long &state) {
+  unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z>>30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z>>27)) * 0x94D049BB133111EBULL;
+  return z ^ (z>>31);
+}
+
+static int RandomBelow(unsigned long long &state,int n) {
+  return (int)(NextRandom(state)%(unsigned long long)n);
+}
+
+// one box in this many is of each of the special kinds
+const int GENERATE_SPECIAL_EVERY = 16;
+
+// the properties of the words that the rules of generated boxes test
+const int      GENERATE_WORD_COUNT = 4;
+const unsigned GENERATE_WORDS[GENERATE_WORD_COUNT] = {
+  PROP_WORD_RED,PROP_WORD_GREEN,PROP_WORD_WORD,PROP_IF_SENTENCE
+};
+
+BOOL Maze::Generate(int boxes,int branching,unsigned long seed,int pencils,std::ostream &err) {
+  std::ostringstream name;
+  name << "generated maze " << boxes << "," << branching << "," << seed;
+  if (boxes<pencils || branching<0 || 100<branching) {
+    err << name.str() << ": needs at least one box per pencil and a branching of 0 to 100 percent"
+        << std::endl << std::flush;
+    return FALSE;
+  }
+  unsigned long long random    = seed;
+  BoxRule           *generated = new BoxRule[boxes+1];
+  for (int i=0;i<boxes;i++) {
+    BoxRule &rule = generated[i];
+    rule.number  = i+1;
+    rule.mask    = 0;
+    rule.effects = 0;
+    rule.flag    = FLAG_RULE60;
+    rule.yes     = 1+RandomBelow(random,boxes);
+    rule.no      = 1+RandomBelow(random,boxes);
+    // the text: red, green or black, and its words
+    int colour = RandomBelow(random,10);
+    rule.properties = (colour<3) ? PROP_RED_TEXT : (colour<5) ? PROP_GREEN_TEXT : 0;
+    if (RandomBelow(random,3)==0)  rule.properties |= PROP_WORD_RED;
+    if (RandomBelow(random,3)==0)  rule.properties |= PROP_WORD_GREEN;
+    if (RandomBelow(random,6)==0)  rule.properties |= PROP_WORD_WORD;
+    if (RandomBelow(random,5)==0)  rule.properties |= PROP_IF_SENTENCE;
+    if (RandomBelow(random,20)==0) rule.properties |= PROP_REFERS_TO_COWS;
+    // the rule
+    switch (RandomBelow(random,GENERATE_SPECIAL_EVERY)) {
+    case 0:
+      rule.kind       = RULE_ALWAYS;
+      rule.effects    = EFFECT_SET_RULE60;
+      rule.properties = (rule.properties & ~PROP_RED_TEXT) | PROP_GREEN_TEXT;
+      break;
+    case 1:
+      rule.kind    = RULE_ALWAYS;
+      rule.effects = EFFECT_CLEAR_RULE60;
+      break;
+    case 2:
+      rule.kind       = RULE_ALWAYS;
+      rule.effects    = EFFECT_MOVE_OTHER;
+      rule.properties = (rule.properties & ~PROP_GREEN_TEXT) | PROP_RED_TEXT;
+      break;
+    case 3:
+      rule.kind = RULE_COUNTERFACTUAL;
+      break;
+    case 4:
+      rule.kind = RULE_CHOICE;
+      break;
+    default:
+      if (RandomBelow(random,100)>=branching) {
+        rule.kind = RULE_ALWAYS;
+        break;
+      }
+      switch (RandomBelow(random,5)) {
+      case 0:
+        rule.kind = RULE_OTHER_HAS;
+        rule.mask = (RandomBelow(random,2)==0) ? PROP_RED_TEXT|PROP_GREEN_TEXT
+                  : (RandomBelow(random,2)==0) ? PROP_RED_TEXT : PROP_GREEN_TEXT;
+        break;
+      case 1:
+        rule.kind = RULE_OTHER_HAS;
+        rule.mask = GENERATE_WORDS[RandomBelow(random,GENERATE_WORD_COUNT)];
+        if (RandomBelow(random,2)==0) rule.mask |= GENERATE_WORDS[RandomBelow(random,GENERATE_WORD_COUNT)];
+        break;
+      case 2:
+        rule.kind = RULE_OTHER_HAS;
+        rule.mask = (RandomBelow(random,2)==0) ? PROP_ODD_NUMBER : PROP_MULTIPLE_OF_FIVE;
+        break;
+      case 3:
+        rule.kind = RULE_SELF_HAS;
+        rule.mask = (RandomBelow(random,2)==0) ? PROP_RED_TEXT : PROP_GREEN_TEXT;
+        break;
+      default:
+        rule.kind = RULE_OTHER_MOVED;
+      }
+    }
+    if (rule.kind==RULE_ALWAYS) rule.no = rule.yes;
+  }
+  // the way out
+  BoxRule &goal = generated[RandomBelow(random,boxes)];
+  goal.kind        = RULE_OTHER_HAS;
+  goal.mask        = PROP_REFERS_TO_COWS;
+  goal.yes         = GOAL_MAZEPOINT;
+  goal.effects     = 0;
+  goal.properties |= PROP_REFERS_TO_COWS;
+  // distinct start boxes
+  int startIn[MAX_PENCILS];
+  for (int p=0;p<pencils && p<MAX_PENCILS;p++) {
+    BOOL taken;
+    do {
+      startIn[p] = 1+RandomBelow(random,boxes);
+      taken      = FALSE;
+      for (int q=0;q<p;q++) taken = taken || startIn[q]==startIn[p];
+    } while (taken);
+  }
+  Clear();
+  boxCount    = boxes;
+  rules       = generated;
+  pencilCount = pencils;
+  flagCount   = 1;
+  for (int p=0;p<pencils && p<MAX_PENCILS;p++) start[p] = startIn[p];
+  return Finish(name.str().c_str(),err);
+}
+
+static void WriteNameList(std::ostream &os,unsigned bits,const char **names,int count) {
+  BOOL first = TRUE;
+  for (int i=0;i<count;i++) {
+    if (bits & (1u<<i)) {
+      os << (first ? "" : ",") << names[i];
+      first = FALSE;
+    }
+  }
+}
+
+static void WriteTarget(std::ostream &os,int target) {
+  if (target==GOAL_MAZEPOINT) os << "goal";
+  else                        os << target;
+}
+
+void Maze::Write(std::ostream &os) const {
+  os << "start";
+  for (int p=0;p<pencilCount;p++) os << " " << start[p];
+  os << std::endl;
+  if (flagCount!=1) os << "flags " << flagCount << std::endl;
+  for (int i=0;i<boxCount;i++) {
+    const BoxRule &rule = rules[i];
+    os << "box " << rule.number << " " << RULE_NAME[rule.kind];
+    if (rule.kind==RULE_OTHER_HAS || rule.kind==RULE_SELF_HAS) {
+      os << " ";
+      WriteNameList(os,rule.mask,PROPERTY_NAME,PROPERTY_NAME_COUNT);
+    }
+    os << " yes ";
+    WriteTarget(os,rule.yes);
+    if (rule.kind!=RULE_ALWAYS || rule.no!=rule.yes) {
+      os << " no ";
+      WriteTarget(os,rule.no);
+    }
+    if (rule.effects!=0) {
+      os << " effects ";
+      WriteNameList(os,rule.effects,EFFECT_NAME,EFFECT_NAME_COUNT);
+    }
+    if (rule.properties!=0) {
+      os << " text ";
+      WriteNameList(os,rule.properties,PROPERTY_NAME,PROPERTY_NAME_COUNT);
+    }
+    if (rule.flag!=0) os << " flag " << rule.flag;
+    os << std::endl;
+  }
+  os << std::flush;
+}
+
+int Maze::IndexBits(int boxCount,int pencilCount,int flagCount) {
+  return pencilCount*BitsNeeded(boxCount)+pencilCount+flagCount;
+}
+
+const BoxRule *Maze::Rules(void) const {
+  return rules;
+}
+
+void Maze::Install(const Maze &maze) {
+  current = &maze;
+  State::SetLayout(maze.BoxCount(),maze.PencilCount(),maze.FlagCount());
+}
+
+// =================================================================================
+// Definitions for "State";
+// =================================================================================
+
+int           State::pencils;
+int           State::flags;
+int           State::pencilBits;
+int           State::indexBits;
+int           State::pencilShift[MAX_PENCILS];
+int           State::movedBit[MAX_PENCILS];
+unsigned long State::pencilMask;
+unsigned long State::indexMask;
+unsigned long State::illegalBit[MAX_PENCILS];
+unsigned long State::goalBit[MAX_PENCILS];
+unsigned long State::illegalMask;
+unsigned long State::goalMask;
+
+void State::SetLayout(int boxCount,int pencilsIn,int flagsIn) {
+  if (pencilsIn<1 || MAX_PENCILS<pencilsIn || flagsIn<1 || MAX_FLAGS<flagsIn) {
+    std::cerr << "State::SetLayout(): Illegal number of pencils or flags" << std::endl << std::flush;
+    abort();
+  }
+  pencils    = pencilsIn;
+  flags      = flagsIn;
+  pencilBits = BitsNeeded(boxCount);
+  indexBits  = pencils*pencilBits+pencils+flags;
+  if (indexBits>STATE_MAX_INDEX_BITS) {
+    std::cerr << "State::SetLayout(): Too many boxes" << std::endl << std::flush;
+    abort();
+  }
+  pencilMask  = (1UL<<pencilBits)-1;
+  indexMask   = (1UL<<indexBits)-1;
+  illegalMask = 0;
+  goalMask    = 0;
+  for (int p=0;p<pencils;p++) {
+    int fromTop    = pencils-1-p; // pencil 0 is the most significant one
+    pencilShift[p] = flags+fromTop*pencilBits;
+    movedBit[p]    = flags+pencils*pencilBits+fromTop;
+    illegalBit[p]  = 1UL<<(indexBits+fromTop);
+    goalBit[p]     = 1UL<<(indexBits+pencils+fromTop);
+    illegalMask   |= illegalBit[p];
+    goalMask      |= goalBit[p];
+  }
+}
+
+State::State(void) {
+  code = illegalMask;
+}
+
+std::ostream &operator<<(std::ostream &os,const State &s) {
+  os << "(";
+  for (int p=0;p<State::Pencils();p++) {
+    if (s.MovementP(p)) os << "m"; else os << ".";
+  }
+  os << ",";
+  for (int p=0;p<State::Pencils();p++) {
+    if (s.Pencil(p)==ILLEGAL_MAZEPOINT) {
+      os << "XX";
+    }
+    else if (s.Pencil(p)==GOAL_MAZEPOINT) {
+      os << "GG";
+    }
+    else {
+      os.width(2);
+      os << s.Pencil(p);
+    }
+    os << ",";
+  }
+  for (int f=0;f<State::Flags();f++) {
+    if (s.FlagP(f)) os << "*"; else os << " ";
+  }
+  os << ")";
+  return os;
+}
+
+// =================================================================================
+// Definitions for "Transition"
+// =================================================================================
+
+Transition::Transition(void) {
+  for (int p=0;p<MAX_PENCILS;p++) {
+    exitPath[p] = PATH_NONE;
+  }
+}
+
+void Transition::SetCurrentState(const State &currentIn) {
+  current = currentIn;
+}
+
+// ---------------------------------------------------------------------------------
+// The next state if the rule in the box of 'chosenPencil' is considered, or
+// with 'alternate', the state reached on its LUGNUT exit. The exit path ('YES',
+// 'NO' or 'LUGNUT' in the single nondeterministic choice) must have been
+// recorded by Searcher::ExitPaths().
+// ---------------------------------------------------------------------------------
+
+State Transition::Successor(int chosenPencil,BOOL alternate) const {
+  State next        = current;
+  int   otherPencil = (chosenPencil+1)%State::Pencils();
+  for (int p=0;p<State::Pencils();p++) next.SetMovement(p,FALSE);
+  if (current.IllegalP() || current.GoalP()) {
+    std::cerr << "Transition::Successor(): not a normal current state" << std::endl << std::flush;
+    abort();
+  }
+  const BoxRule &rule = Maze::Current().Rule(current.BoxIndex(chosenPencil));
+  int pathTaken = exitPath[chosenPencil];
+  if (pathTaken==PATH_NONE) {
+    // deadly embrace
+    next.SetPencil(chosenPencil,ILLEGAL_MAZEPOINT);
+    next.SetPencil(otherPencil,ILLEGAL_MAZEPOINT);
+    return next;
+  }
+  // the LUGNUT exit of a free choice is its 'no' exit
+  next.SetPencil(chosenPencil,(alternate || pathTaken==PATH_NO) ? rule.no : rule.yes);
+  next.SetMovement(chosenPencil,TRUE);
+  // the effects only take place if the rule has been followed, not if red text
+  // has been ignored
+  BOOL followed = !(current.Rule60P() && (rule.properties & PROP_RED_TEXT));
+  if (followed) {
+    if (rule.effects & EFFECT_SET_RULE60)   next.SetRule60(TRUE);
+    if (rule.effects & EFFECT_CLEAR_RULE60) next.SetRule60(FALSE);
+    if (rule.effects & EFFECT_SET_FLAG)     next.SetFlag(rule.flag,TRUE);
+    if (rule.effects & EFFECT_CLEAR_FLAG)   next.SetFlag(rule.flag,FALSE);
+    if (rule.effects & EFFECT_MOVE_OTHER) {
+      next.SetPencil(otherPencil,Maze::Current().Rule(current.BoxIndex(otherPencil)).yes);
+      next.SetMovement(otherPencil,TRUE);
+    }
+  }
+  return next;
+}
+
+std::ostream &operator<<(std::ostream &os,const Transition &t) {
+  os << t.CurrentState() << " -> ";
+  for (int p=0;p<State::Pencils();p++) {
+    if (p>0) os << " & ";
+    os << t.NextState(p);
+    if (t.AltNextValidP(p)) {
+      os << " or " << t.AltNextState(p);
+    }
+    os << " (p" << p << ")";
+  }
+  os << " ";
+  return os;
+}
+
+// =================================================================================
+// Definitions for "SuccessorGraph"
+// =================================================================================
+
+SuccessorGraph::SuccessorGraph(long stateCountIn) {
+  stateCount   = stateCountIn;
+  addedStates  = 0;
+  edgeCount    = 0;
+  edgeCapacity = 0;
+  bases        = new EdgeOffset[stateCount/OFFSET_BLOCK+1];
+  deltas       = new EdgeDelta[stateCount+1];
+  successors   = NULL;
+  bases[0]     = 0;
+  deltas[0]    = 0;
+  owned        = TRUE;
+  Resize(2*(unsigned long)stateCount); // the usual number of successors
+}
+
+SuccessorGraph::SuccessorGraph(long stateCountIn,const EdgeOffset *offsets,StateIndex *successorsIn) {
+  stateCount   = stateCountIn;
+  addedStates  = stateCount;
+  bases        = new EdgeOffset[stateCount/OFFSET_BLOCK+1];
+  deltas       = new EdgeDelta[stateCount+1];
+  successors   = successorsIn;
+  edgeCount    = offsets[stateCount];
+  edgeCapacity = edgeCount;
+  owned        = TRUE;
+  for (long i=0;i<=stateCount;i++) SetOffset(i,offsets[i]);
+}
+
+SuccessorGraph::SuccessorGraph(long stateCountIn,EdgeOffset *basesIn,EdgeDelta *deltasIn,
+                               StateIndex *successorsIn,BOOL ownedIn) {
+  stateCount   = stateCountIn;
+  addedStates  = stateCount;
+  bases        = basesIn;
+  deltas       = deltasIn;
+  successors   = successorsIn;
+  edgeCount    = Offset(stateCount);
+  edgeCapacity = edgeCount;
+  owned        = ownedIn;
+}
+
+SuccessorGraph::~SuccessorGraph(void) {
+  if (owned) {
+    delete[] bases;
+    delete[] deltas;
+    free(successors);
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Set the offset of the first successor of state 'index' (of the end of the
+// last state's successors for 'stateCount'); the first state of a block sets
+// the block's base
+// ---------------------------------------------------------------------------------
+
+void SuccessorGraph::SetOffset(long index,EdgeOffset offset) {
+  if (index%OFFSET_BLOCK==0) bases[index/OFFSET_BLOCK] = offset;
+  EdgeOffset delta = offset-bases[index/OFFSET_BLOCK];
+  if (delta>UINT_MAX) {
+    std::cerr << "SuccessorGraph::SetOffset(): Too many successors in a block of states" << std::endl << std::flush;
+    abort();
+  }
+  deltas[index] = (EdgeDelta)delta;
+}
+
+void SuccessorGraph::Resize(EdgeOffset capacity) {
+  StateIndex *resized = (StateIndex *)realloc(successors,(capacity>0 ? capacity : 1)*sizeof(StateIndex));
+  if (resized==NULL) throw std::bad_alloc();
+  successors   = resized;
+  edgeCapacity = capacity;
+}
+
+void SuccessorGraph::AddState(void) {
+  assert(owned);
+  if (addedStates==stateCount) {
+    std::cerr << "SuccessorGraph::AddState(): Too many states added" << std::endl << std::flush;
+    abort();
+  }
+  // the entry after the state is kept up to date by AddSuccessor()
+  addedStates++;
+  SetOffset(addedStates,edgeCount);
+}
+
+void SuccessorGraph::AddSuccessor(StateIndex x) {
+  assert(addedStates>0);
+  if (edgeCount==edgeCapacity) {
+    // grow the flat array by half; realloc() mostly remaps large arrays in place
+    Resize(edgeCapacity+edgeCapacity/2+MAX_SUCCESSORS);
+  }
+  successors[edgeCount++] = x;
+  SetOffset(addedStates,edgeCount);
+}
+
+void SuccessorGraph::Shrink(void) {
+  Resize(edgeCount);
+}
+
+long SuccessorGraph::StateCount(void) const {
+  return stateCount;
+}
+
+long SuccessorGraph::EdgeCount(void) const {
+  return (long)edgeCount;
+}
+
+long SuccessorGraph::Bytes(void) const {
+  return (long)(BaseCount()*sizeof(EdgeOffset) + (stateCount+1)*sizeof(EdgeDelta) +
+                edgeCapacity*sizeof(StateIndex));
+}
+
+long SuccessorGraph::BaseCount(void) const {
+  return stateCount/OFFSET_BLOCK+1;
+}
+
+const EdgeOffset *SuccessorGraph::BaseArray(void) const {
+  return bases;
+}
+
+const EdgeDelta *SuccessorGraph::DeltaArray(void) const {
+  return deltas;
+}
+
+const StateIndex *SuccessorGraph::SuccessorArray(void) const {
+  return successors;
+}
+
+// =================================================================================
+// Definitions for the built-in maze solved at compile time
+// =================================================================================
+
+BOOL BuiltinMazeP(const Maze &maze) {
+  if (maze.BoxCount()!=MAZEPOINT_COUNT || maze.PencilCount()!=BUILTIN_PENCILS || maze.FlagCount()!=1) return FALSE;
+  if (maze.Start(0)!=START_PENCIL_0 || maze.Start(1)!=START_PENCIL_1) return FALSE;
+  for (int i=0;i<MAZEPOINT_COUNT;i++) {
+    if (memcmp(&maze.Rule(i),&MAZE_RULES[i],sizeof(BoxRule))!=0) return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL PrintBuiltinSolution(std::ostream &os) {
+  if (!BuiltinMazeP(Maze::Current())) {
+    std::cerr << "The compile-time solution is only known for the built-in maze" << std::endl << std::flush;
+    return FALSE;
+  }
+  int length = BUILTIN_SOLUTION.length;
+  std::cerr << "Goal state encountered at " << length << "!" << std::endl << std::flush;
+  os << "---- Shortest path, depth " << length << "\n";
+  for (int i=0;i<length;i++) {
+    os << State::FromIndex(BUILTIN_SOLUTION.path[i]) << "\n";
+  }
+  os << "The maximal search depth encountered is " << length << std::endl << std::flush;
+  return TRUE;
+}
+
+// =================================================================================
+// Definitions for "MazeImage"
+// =================================================================================
+
+MazeImage::MazeImage(void) {
+  base = NULL;
+  size = 0;
+  maze = NULL;
+}
+
+MazeImage::~MazeImage(void) {
+  Close();
+}
+
+void MazeImage::Close(void) {
+  delete maze;
+  if (base!=NULL) munmap(base,(size_t)size);
+  maze = NULL;
+  base = NULL;
+  size = 0;
+}
+
+unsigned int MazeImage::Sizes(void) {
+  return (unsigned int)(sizeof(BoxRule)<<16 | sizeof(StateIndex)<<8 | sizeof(long));
+}
+
+static long ImageAlign(long offset) {
+  return (offset+7) & ~7L;
+}
+
+BOOL MazeImage::Write(const char *fileName,const Maze &maze,const SuccessorGraph &graph,
+                      BOOL symmetric,std::ostream &err) {
+  MazeImageHeader header;
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,MAZE_IMAGE_MAGIC,sizeof(header.magic));
+  header.version          = MAZE_IMAGE_VERSION;
+  header.byteOrder        = MAZE_IMAGE_BYTE_ORDER;
+  header.sizes            = Sizes();
+  header.boxCount         = maze.BoxCount();
+  header.pencilCount      = maze.PencilCount();
+  header.flagCount        = maze.FlagCount();
+  for (int p=0;p<maze.PencilCount();p++) header.start[p] = maze.Start(p);
+  header.indexBits        = State::IndexBits();
+  header.symmetric        = symmetric ? 1 : 0;
+  header.stateCount       = graph.StateCount();
+  header.edgeCount        = graph.EdgeCount();
+  header.rulesOffset      = ImageAlign(sizeof(header));
+  header.basesOffset      = ImageAlign(header.rulesOffset+header.boxCount*(long)sizeof(BoxRule));
+  header.deltasOffset     = ImageAlign(header.basesOffset+graph.BaseCount()*(long)sizeof(EdgeOffset));
+  header.successorsOffset = ImageAlign(header.deltasOffset+(header.stateCount+1)*(long)sizeof(EdgeDelta));
+  header.fileSize         = header.successorsOffset+header.edgeCount*(long)sizeof(StateIndex);
+  std::ofstream os(fileName,std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!os) {
+    err << fileName << ": cannot be written" << std::endl << std::flush;
+    return FALSE;
+  }
+  static const char padding[8] = {0};
+  os.write((const char *)&header,sizeof(header));
+  os.write(padding,header.rulesOffset-(long)sizeof(header));
+  os.write((const char *)maze.Rules(),header.boxCount*(long)sizeof(BoxRule));
+  os.write(padding,header.basesOffset-(header.rulesOffset+header.boxCount*(long)sizeof(BoxRule)));
+  os.write((const char *)graph.BaseArray(),graph.BaseCount()*(long)sizeof(EdgeOffset));
+  os.write(padding,header.deltasOffset-(header.basesOffset+graph.BaseCount()*(long)sizeof(EdgeOffset)));
+  os.write((const char *)graph.DeltaArray(),(header.stateCount+1)*(long)sizeof(EdgeDelta));
+  os.write(padding,header.successorsOffset-(header.deltasOffset+(header.stateCount+1)*(long)sizeof(EdgeDelta)));
+  os.write((const char *)graph.SuccessorArray(),header.edgeCount*(long)sizeof(StateIndex));
+  os.close();
+  if (!os) {
+    err << fileName << ": error while writing" << std::endl << std::flush;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL MazeImage::Open(const char *fileName,std::ostream &err) {
+  int fd = open(fileName,O_RDONLY);
+  if (fd<0) {
+    err << fileName << ": cannot be opened" << std::endl << std::flush;
+    return FALSE;
+  }
+  struct stat st;
+  if (fstat(fd,&st)!=0 || st.st_size<(off_t)sizeof(MazeImageHeader)) {
+    err << fileName << ": not a maze image" << std::endl << std::flush;
+    close(fd);
+    return FALSE;
+  }
+  size = (long)st.st_size;
+  base = mmap(NULL,(size_t)size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (base==MAP_FAILED) {
+    base = NULL;
+    err << fileName << ": cannot be mapped" << std::endl << std::flush;
+    return FALSE;
+  }
+  if (!Check(fileName,err)) {
+    Close();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// ---------------------------------------------------------------------------------
+// Check the mapped image (see "MazeImage") and build its maze
+// ---------------------------------------------------------------------------------
+
+BOOL MazeImage::Check(const char *fileName,std::ostream &err) {
+  const MazeImageHeader *header = (const MazeImageHeader *)base;
+  // does a section of 'count' items of 'bytes' bytes at 'offset' fit?
+  auto inside = [this](long offset,long count,long bytes) {
+    return offset>=(long)sizeof(MazeImageHeader) && offset%8==0 && offset<=size &&
+           count>=0 && count<=(size-offset)/bytes;
+  };
+  if (memcmp(header->magic,MAZE_IMAGE_MAGIC,sizeof(header->magic))!=0 ||
+      header->version!=MAZE_IMAGE_VERSION) {
+    err << fileName << ": not a maze image" << std::endl << std::flush;
+    return FALSE;
+  }
+  if (header->byteOrder!=MAZE_IMAGE_BYTE_ORDER || header->sizes!=Sizes()) {
+    err << fileName << ": written on a different kind of machine" << std::endl << std::flush;
+    return FALSE;
+  }
+  if (header->boxCount<0 || header->stateCount<0 || header->edgeCount<0 ||
+      header->indexBits<1 || STATE_MAX_INDEX_BITS<header->indexBits ||
+      (header->symmetric!=0 && header->symmetric!=1)) {
+    err << fileName << ": corrupt header" << std::endl << std::flush;
+    return FALSE;
+  }
+  if (header->fileSize!=size ||
+      !inside(header->rulesOffset,header->boxCount,sizeof(BoxRule)) ||
+      header->stateCount==LONG_MAX ||
+      !inside(header->basesOffset,header->stateCount/OFFSET_BLOCK+1,sizeof(EdgeOffset)) ||
+      !inside(header->deltasOffset,header->stateCount+1,sizeof(EdgeDelta)) ||
+      !inside(header->successorsOffset,header->edgeCount,sizeof(StateIndex))) {
+    err << fileName << ": truncated" << std::endl << std::flush;
+    return FALSE;
+  }
+  maze = new Maze((const BoxRule *)((const char *)base+header->rulesOffset),header->boxCount,
+                  header->pencilCount,header->flagCount,header->start);
+  if (!maze->Finish(fileName,err)) {
+    return FALSE;
+  }
+  // the graph must be the one of these rules
+  if (Maze::IndexBits(header->boxCount,header->pencilCount,header->flagCount)!=header->indexBits ||
+      (1L<<header->indexBits)!=header->stateCount) {
+    err << fileName << ": the successor graph does not match the maze" << std::endl << std::flush;
+    return FALSE;
+  }
+  const EdgeOffset *bases      = (const EdgeOffset *)((const char *)base+header->basesOffset);
+  const EdgeDelta  *deltas     = (const EdgeDelta *)((const char *)base+header->deltasOffset);
+  const StateIndex *successors = (const StateIndex *)((const char *)base+header->successorsOffset);
+  // every block starts at its base, and no offset may be below the one before
+  EdgeOffset last = 0;
+  for (long i=0;i<=header->stateCount;i++) {
+    EdgeOffset offset = bases[i/OFFSET_BLOCK]+deltas[i];
+    if ((i%OFFSET_BLOCK==0 && deltas[i]!=0) || offset<last || offset<bases[i/OFFSET_BLOCK]) {
+      err << fileName << ": corrupt successor graph" << std::endl << std::flush;
+      return FALSE;
+    }
+    last = offset;
+  }
+  if (bases[0]!=0 || last!=(EdgeOffset)header->edgeCount) {
+    err << fileName << ": corrupt successor graph" << std::endl << std::flush;
+    return FALSE;
+  }
+  for (long i=0;i<header->edgeCount;i++) {
+    StateIndex x = successors[i];
+    if (x!=SUCCESSOR_GOAL && x!=SUCCESSOR_ILLEGAL && (x<0 || header->stateCount<=x)) {
+      err << fileName << ": corrupt successor graph" << std::endl << std::flush;
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+const Maze &MazeImage::GetMaze(void) const {
+  assert(maze!=NULL);
+  return *maze;
+}
+
+BOOL MazeImage::Symmetric(void) const {
+  return ((const MazeImageHeader *)base)->symmetric!=0;
+}
+
+SuccessorGraph *MazeImage::NewGraph(void) const {
+  const MazeImageHeader *header = (const MazeImageHeader *)base;
+  return new SuccessorGraph(header->stateCount,
+                            (EdgeOffset *)((char *)base+header->basesOffset),
+                            (EdgeDelta *)((char *)base+header->deltasOffset),
+                            (StateIndex *)((char *)base+header->successorsOffset),
+                            FALSE);
+}
+
+#ifdef COWS_STATS
+
+// =================================================================================
+// Definitions for "SearchStats"
+// =================================================================================
+
+SearchStats::SearchStats(void) {
+  expanded      = 0;
+  reexpanded    = 0;
+  duplicates    = 0;
+  goalHits      = 0;
+  illegalHits   = 0;
+  buildSeconds  = 0;
+  searchSeconds = 0;
+  dumpSeconds   = 0;
+}
+
+inline void SearchStats::Expanded(int depth) {
+  expanded++;
+  if (expanded%STATS_PROGRESS==0) {
+    std::cerr << "... " << expanded << " states expanded, depth " << depth << std::endl << std::flush;
+  }
+}
+
+inline void SearchStats::Level(int depth,long states) {
+  if ((int)frontier.size()<depth) frontier.resize(depth,0);
+  frontier[depth-1] += states;
+}
+
+void SearchStats::WriteJson(std::ostream &os) const {
+  os << "{\n"
+     << "  \"expanded\": "    << expanded    << ",\n"
+     << "  \"reexpanded\": "  << reexpanded  << ",\n"
+     << "  \"duplicates\": "  << duplicates  << ",\n"
+     << "  \"goalHits\": "    << goalHits    << ",\n"
+     << "  \"illegalHits\": " << illegalHits << ",\n"
+     << "  \"frontier\": [";
+  for (size_t i=0;i<frontier.size();i++) {
+    os << (i==0 ? "" : ",") << frontier[i];
+  }
+  os << "],\n"
+     << "  \"seconds\": { \"build\": " << buildSeconds << ", \"search\": " << searchSeconds
+     << ", \"dump\": " << dumpSeconds << " }\n"
+     << "}\n" << std::flush;
+}
+
+#endif
+
+// =================================================================================
+// Definitions for "SearchArena"
+// =================================================================================
+
+SearchArena::SearchArena(long statesIn) {
+  states      = statesIn;
+  visited     = new int[states];
+  visitedBase = 0;
+  visitedTop  = 0;
+  memset(visited,0,states*sizeof(int));
+}
+
+SearchArena::~SearchArena(void) {
+  delete[] visited;
+}
+
+void SearchArena::Reset(void) {
+  if (visitedTop>INT_MAX/2) {
+    memset(visited,0,states*sizeof(int));
+    visitedTop = 0;
+  }
+  visitedBase = visitedTop;
+  queue.clear();
+}
+
+int SearchArena::Visited(long index) const {
+  int v = visited[index];
+  return (v>visitedBase) ? v-visitedBase : 0;
+}
+
+void SearchArena::SetVisited(long index,int depth) {
+  int v = visitedBase+depth;
+  visited[index] = v;
+  if (visitedTop<v) visitedTop = v;
+}
+
+// =================================================================================
+// Definitions for "Searcher"
+// =================================================================================
+
+Searcher::Searcher(int tableModeIn,int threadsIn,BOOL symmetricIn) {
+  STATS(StatsTimer timer(stats.buildSeconds));
+  tableMode      = tableModeIn;
+  threads        = (threadsIn<1) ? 1 : threadsIn;
+  symmetric      = symmetricIn;
+  space          = NULL;
+  graph          = NULL;
+  pages          = NULL;
+  pageCount      = 0;
+  pagesAllocated = 0;
+  lazyComputed   = 0;
+  visited        = NULL;
+  parent         = NULL;
+  reverse        = NULL;
+  preGoal        = NULL;
+  preGoalCount   = 0;
+  visitedBase    = 0;
+  visitedTop     = 0;
+  origin         = StartState();
+  solution       = -1;
+  liveness       = NULL;
+  pruned         = FALSE;
+  pruneStart     = -1;
+  traceDepth     = TRACE_DEPTH;
+  pruneAll       = FALSE;
+  boxDistance    = NULL;
+  std::cerr << "Allocating state space..." << std::endl << std::flush;
+  if (tableMode==TABLE_LAZY) {
+    // nothing is computed yet, the pages come into existence as the search
+    // proceeds (see Page())
+    pageCount = (TotalStates()+LAZY_PAGE_SIZE-1)/LAZY_PAGE_SIZE;
+    pages     = new LazyPage*[pageCount];
+    for (long i=0;i<pageCount;i++) pages[i] = NULL;
+    return;
+  }
+  else if (tableMode==TABLE_COMPACT) {
+    BuildSuccessorGraph();
+    std::cerr << "Successor graph: " << graph->Bytes() << " bytes" << std::endl << std::flush;
+  }
+  else {
+    space = new Transition[TotalStates()];
+    EnumerateTransitions();
+    std::cerr << "Transition table: " << TotalStates()*(long)sizeof(Transition) << " bytes" << std::endl << std::flush;
+  }
+  visited = new int[TotalStates()];
+  parent  = new StateIndex[TotalStates()];
+  memset(visited,0,TotalStates()*sizeof(int));
+}
+
+Searcher::Searcher(SuccessorGraph *graphIn,int threadsIn,BOOL symmetricIn) {
+  STATS(StatsTimer timer(stats.buildSeconds));
+  tableMode      = TABLE_COMPACT;
+  threads        = (threadsIn<1) ? 1 : threadsIn;
+  symmetric      = symmetricIn;
+  space          = NULL;
+  graph          = graphIn;
+  pages          = NULL;
+  pageCount      = 0;
+  pagesAllocated = 0;
+  lazyComputed   = 0;
+  reverse        = NULL;
+  preGoal        = NULL;
+  preGoalCount   = 0;
+  visitedBase    = 0;
+  visitedTop     = 0;
+  origin         = StartState();
+  solution       = -1;
+  liveness       = NULL;
+  pruned         = FALSE;
+  pruneStart     = -1;
+  traceDepth     = TRACE_DEPTH;
+  pruneAll       = FALSE;
+  boxDistance    = NULL;
+  if (graph->StateCount()!=TotalStates()) {
+    std::cerr << "Searcher::Searcher(): Successor graph does not match the maze" << std::endl << std::flush;
+    abort();
+  }
+  std::cerr << "Successor graph: " << graph->Bytes() << " bytes" << std::endl << std::flush;
+  visited = new int[TotalStates()];
+  parent  = new StateIndex[TotalStates()];
+  memset(visited,0,TotalStates()*sizeof(int));
+}
+
+Searcher::~Searcher(void) {
+  if (pages!=NULL) {
+    std::cerr << "Lazy state space: " << lazyComputed << " transitions computed in "
+              << pagesAllocated << " of " << pageCount << " pages ("
+              << pagesAllocated*(long)sizeof(LazyPage) << " bytes)" << std::endl << std::flush;
+    for (long i=0;i<pageCount;i++) delete pages[i];
+    delete[] pages;
+  }
+  delete[] space;
+  delete graph;
+  delete[] visited;
+  delete[] parent;
+  delete reverse;
+  delete[] preGoal;
+  delete[] liveness;
+  delete[] boxDistance;
+}
+
+// ---------------------------------------------------------------------------------
+// Access to the per-state data, which is held in the pages for TABLE_LAZY and in
+// the 'space', 'visited' and 'parent' arrays otherwise. Page() allocates the page
+// of state 'index' if needed; TransitionAt() computes the transition of state
+// 'index' if needed.
+// ---------------------------------------------------------------------------------
+
+LazyPage &Searcher::Page(long index) {
+  LazyPage *&page = pages[index>>LAZY_PAGE_BITS];
+  if (page==NULL) {
+    page = new LazyPage;
+    memset(page->visited,0,sizeof(page->visited));
+    memset(page->computed,0,sizeof(page->computed));
+    memset(page->liveness,0,sizeof(page->liveness));
+    pagesAllocated++;
+  }
+  return *page;
+}
+
+const Transition &Searcher::TransitionAt(long index) {
+  if (tableMode!=TABLE_LAZY) {
+    return space[index];
+  }
+  LazyPage &page = Page(index);
+  long      slot = index & (LAZY_PAGE_SIZE-1);
+  if (!page.computed[slot]) {
+    ComputeTransition(index,page.trs[slot]);
+    page.computed[slot] = 1;
+    lazyComputed++;
+  }
+  return page.trs[slot];
+}
+
+inline int Searcher::Visited(long index) const {
+  int v;
+  if (tableMode==TABLE_LAZY) {
+    const LazyPage *page = pages[index>>LAZY_PAGE_BITS];
+    v = (page==NULL) ? 0 : page->visited[index & (LAZY_PAGE_SIZE-1)];
+  }
+  else {
+    v = visited[index];
+  }
+  return (v>visitedBase) ? v-visitedBase : 0;
+}
+
+inline void Searcher::SetVisited(long index,int depth) {
+  int v = visitedBase+depth;
+  if (tableMode==TABLE_LAZY) {
+    Page(index).visited[index & (LAZY_PAGE_SIZE-1)] = v;
+  }
+  else {
+    visited[index] = v;
+  }
+  if (visitedTop<v) visitedTop = v;
+}
+
+inline StateIndex Searcher::Parent(long index) const {
+  if (tableMode==TABLE_LAZY) {
+    return pages[index>>LAZY_PAGE_BITS]->parent[index & (LAZY_PAGE_SIZE-1)];
+  }
+  return parent[index];
+}
+
+inline void Searcher::SetParent(long index,StateIndex p) {
+  if (tableMode==TABLE_LAZY) {
+    Page(index).parent[index & (LAZY_PAGE_SIZE-1)] = p;
+  }
+  else {
+    parent[index] = p;
+  }
+}
+
+long Searcher::TotalStates(void) {
+  // This yields the total number of states to check out;
+  // a point in the state space is given by the position
+  // of pencil 0, the position of pencil 1 and two booleans
+  // indicating whether pencil 0 or pencil 1 moved in the
+  // last round and the state of rule 60. That's all the
+  // information one needs.
+  // If one did not want to distinguish state pencil positions
+  // (7,1) and (1,7) for example, one could half the
+  // state space. But it's not sure whether this is 
+  // desirable...
+  // Thus we consider (see the packing of "State") the box indexes of all
+  // pencils, their movement flags and the rule flags (rule 60 and any others):
+  long result = 1L << State::IndexBits();
+  // If the number of boxes is not a power of 2, some of these are never used
+  // (see State::ValidIndexP()).
+  return result;
+}
+
+inline int Searcher::OtherPencil(int pencil) {
+  // the pencil the rules of "the other pencil" refer to
+  return (pencil+1)%State::Pencils();
+}
+
+State Searcher::StartState(void) {
+  const Maze &maze = Maze::Current();
+  State       start;
+  for (int p=0;p<maze.PencilCount();p++) {
+    start.SetPencil(p,maze.Start(p));
+    start.SetMovement(p,FALSE);
+  }
+  for (int f=0;f<maze.FlagCount();f++) {
+    start.SetFlag(f,FALSE);
+  }
+  return start;
+}
+
+inline long Searcher::ComputeIndex(const State &current) {
+  // this yields the index of the state array, which is just the packed
+  // representation of 'current' (the pencil indexes into MAZEPOINT, the
+  // movement flags and the rule 60 flag, see "State")
+  return current.Index();
+}
+
+void Searcher::ComputeTransition(long index,Transition &trs) {
+  trs.SetCurrentState(State::FromIndex(index));
+  // the exit paths of all pencils; the next states follow from them
+  ExitPaths(trs);
+}
+
+// ---------------------------------------------------------------------------------
+// Set paths[i] (i<count) to base[i], or, where that is PATH_FROM_COLUMN, to
+// PATH_YES or PATH_NO as bit i of 'bits' is set or not. The boxes are done 32 at
+// a time with AVX2 or 16 at a time with SSE2, like in MaskColumn(), one at a
+// time otherwise, with the same result.
+// ---------------------------------------------------------------------------------
+
+const unsigned char PATH_FROM_COLUMN = 4;
+
+static void PathColumn(const unsigned long long *bits,const unsigned char *base,int count,unsigned char *paths) {
+  int i = 0;
+#if defined(__AVX2__)
+  const __m256i spread = _mm256_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,
+                                          2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+  const __m256i select = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+  const __m256i yes    = _mm256_set1_epi8(PATH_YES);
+  const __m256i no     = _mm256_set1_epi8(PATH_NO);
+  const __m256i ask    = _mm256_set1_epi8(PATH_FROM_COLUMN);
+  for (;i+32<=count;i+=32) {
+    // byte j of the 32 gets bit j of the word, then becomes 0xFF if it is set
+    __m256i word   = _mm256_set1_epi32((int)(unsigned)(bits[i>>6]>>(i&63)));
+    __m256i hit    = _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(word,spread),select),select);
+    __m256i answer = _mm256_blendv_epi8(no,yes,hit);
+    __m256i b      = _mm256_loadu_si256((const __m256i *)(base+i));
+    _mm256_storeu_si256((__m256i *)(paths+i),_mm256_blendv_epi8(b,answer,_mm256_cmpeq_epi8(b,ask)));
+  }
+#elif defined(__SSE2__)
+  const __m128i select = _mm_set1_epi64x((long long)0x8040201008040201ULL);
+  const __m128i yes    = _mm_set1_epi8(PATH_YES);
+  const __m128i no     = _mm_set1_epi8(PATH_NO);
+  const __m128i ask    = _mm_set1_epi8(PATH_FROM_COLUMN);
+  for (;i+16<=count;i+=16) {
+    unsigned w      = (unsigned)(bits[i>>6]>>(i&63));
+    __m128i  spread = _mm_unpacklo_epi64(_mm_set1_epi8((char)(w & 0xFF)),_mm_set1_epi8((char)((w>>8) & 0xFF)));
+    __m128i  hit    = _mm_cmpeq_epi8(_mm_and_si128(spread,select),select);
+    __m128i  answer = _mm_or_si128(_mm_and_si128(hit,yes),_mm_andnot_si128(hit,no));
+    __m128i  b      = _mm_loadu_si128((const __m128i *)(base+i));
+    __m128i  take   = _mm_cmpeq_epi8(b,ask);
+    _mm_storeu_si128((__m128i *)(paths+i),_mm_or_si128(_mm_and_si128(take,answer),_mm_andnot_si128(take,b)));
+  }
+#endif
+  for (;i<count;i++) {
+    if (base[i]!=PATH_FROM_COLUMN) paths[i] = base[i];
+    else paths[i] = ((bits[i>>6]>>(i&63)) & 1) ? PATH_YES : PATH_NO;
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// The tables are built a row of states at a time. A row is the states that share
+// the movement flags and the boxes of all pencils but the last one; the last
+// pencil's box and the rule flags vary in it, so it is RowLength() consecutive
+// indexes. For every setting of the rule flags, the exit paths of a pencil are
+// a column over the last pencil's box:
+// - a pencil with a fixed box takes a fixed exit path, unless its box asks
+//   about the last pencil (RULE_OTHER_HAS, the last pencil being the other). Its
+//   column then is the box's column of the rule table (Maze::OtherYesColumn()).
+// - the last pencil asks about pencil 0, whose box is fixed. Its other-has
+//   boxes answer with the bit column MaskColumn() gives for their masks and the
+//   properties of that box. What the other boxes answer only depends on the
+//   box, the rule flags and whether pencil 0 moved: LastPencilPaths() makes a
+//   table of it once per build, with PATH_FROM_COLUMN for the other-has boxes.
+// PathColumn() makes the exit paths of the columns, and they are written to the
+// transitions of the row ('trs', RowLength() of them; those of states that are
+// not listed are left alone). Counterfactual boxes are resolved per state, as in
+// ExitPaths(). The transitions are the same as those of ComputeTransition().
+// The columns and the bit column are kept in 'scratch', which RowScratch()
+// allocates; every building thread has one of its own and uses it for all of
+// its rows.
+// ---------------------------------------------------------------------------------
+
+long Searcher::RowLength(void) {
+  // the last pencil's box field and the rule flags below it (see "State")
+  return (TotalStates()/State::BoxStates())<<State::Flags();
+}
+
+unsigned char *Searcher::LastPencilPaths(void) {
+  const Maze    &maze  = Maze::Current();
+  int            boxes = maze.BoxCount();
+  int            last  = State::Pencils()-1;
+  long           words = 1L<<State::Flags();
+  unsigned char *paths = new unsigned char[words*2*boxes];
+  for (long f=0;f<words;f++) {
+    for (int moved=0;moved<2;moved++) {
+      unsigned char *column = paths+(f*2+moved)*boxes;
+      // the rule flags are the lowest bits of an index, the boxes are all box 0
+      State s = State::FromIndex(f);
+      s.SetMovement(0,moved);
+      for (int b=0;b<boxes;b++) {
+        BOOL ignored = s.Rule60P() && (maze.Properties(b) & PROP_RED_TEXT);
+        s.SetPencil(last,maze.Number(b));
+        if (maze.Rule(b).kind==RULE_OTHER_HAS && !ignored) {
+          column[b] = PATH_FROM_COLUMN;
+        }
+        else {
+          column[b] = (unsigned char)DirectExitPath(last,s);
+        }
+      }
+    }
+  }
+  return paths;
+}
+
+unsigned long long *Searcher::RowScratch(void) {
+  // the bit column, then a column per pencil and the one PathColumn() uses to
+  // ask which of the fixed pencils' boxes take the answer of the column
+  int                 boxes   = Maze::Current().BoxCount();
+  long                words   = (boxes+63)/64;
+  long                bytes   = (long)(State::Pencils()+1)*boxes;
+  unsigned long long *scratch = new unsigned long long[words+(bytes+7)/8];
+  memset((unsigned char *)(scratch+words)+(long)State::Pencils()*boxes,PATH_FROM_COLUMN,boxes);
+  return scratch;
+}
+
+void Searcher::ComputeTransitionRow(long row,const unsigned char *lastPaths,unsigned long long *scratch,
+                                    Transition *trs) const {
+  const Maze &maze    = Maze::Current();
+  int         boxes   = maze.BoxCount();
+  int         pencils = State::Pencils();
+  int         last    = pencils-1;
+  int         flags   = State::Flags();
+  long        first   = row*RowLength();
+  // with the last pencil at box 0, this only fails if another one is past the
+  // boxes (see State::ValidIndexP()), and so do all states of the row
+  if (!State::ValidIndexP(first)) return;
+  unsigned long long  *bits    = scratch;
+  unsigned char       *columns = (unsigned char *)(scratch+(boxes+63)/64);
+  const unsigned char *ask     = columns+(long)pencils*boxes;
+  for (long f=0;f<(1L<<flags);f++) {
+    State fixed = State::FromIndex(first+f);
+    BOOL  counterfactual[MAX_PENCILS];
+    BOOL  fixedCounterfactual = FALSE;
+    for (int p=0;p<last;p++) {
+      int            self    = fixed.BoxIndex(p);
+      const BoxRule &rule    = maze.Rule(self);
+      BOOL           ignored = fixed.Rule60P() && (maze.Properties(self) & PROP_RED_TEXT);
+      unsigned char *column  = columns+(long)p*boxes;
+      counterfactual[p]    = rule.kind==RULE_COUNTERFACTUAL && !ignored;
+      fixedCounterfactual |= counterfactual[p];
+      if (rule.kind==RULE_OTHER_HAS && !ignored && OtherPencil(p)==last) {
+        PathColumn(maze.OtherYesColumn(self),ask,boxes,column);
+      }
+      else {
+        memset(column,DirectExitPath(p,fixed),boxes);
+      }
+    }
+    const unsigned char *base = lastPaths+(f*2+(fixed.MovementP(0) ? 1 : 0))*boxes;
+    MaskColumn(maze.OtherHasMasks(),boxes,maze.Properties(fixed.BoxIndex(0)),bits);
+    PathColumn(bits,base,boxes,columns+(long)last*boxes);
+    for (int b=0;b<boxes;b++) {
+      long index = first+((long)b<<flags)+f;
+      if (!ListedP(index)) continue;
+      unsigned char paths[MAX_PENCILS];
+      for (int p=0;p<pencils;p++) {
+        paths[p] = columns[(long)p*boxes+b];
+      }
+      // only a counterfactual box takes no exit by itself
+      counterfactual[last] = base[b]==PATH_NONE;
+      if (fixedCounterfactual || counterfactual[last]) {
+        ResolveCounterfactuals(counterfactual,paths);
+      }
+      Transition &t = trs[index-first];
+      t.SetCurrentState(State::FromIndex(index));
+      for (int p=0;p<pencils;p++) {
+        t.SetExitPath(p,paths[p]);
+      }
+    }
+  }
+}
+
+void Searcher::EnumerateTransitions(void) {
+  // the index of a state is its packed representation, so the state space
+  // can just be walked linearly, a row at a time; every thread fills its own
+  // part of 'space'
+  unsigned char *lastPaths = LastPencilPaths();
+  long           length    = RowLength();
+  ParallelFor(0,TotalStates()/length,threads,[this,lastPaths,length](long from,long to,int) {
+    unsigned long long *scratch = RowScratch();
+    for (long row=from;row<to;row++) {
+      ComputeTransitionRow(row,lastPaths,scratch,space+row*length);
+    }
+    delete[] scratch;
+  });
+  delete[] lastPaths;
+}
+
+// ---------------------------------------------------------------------------------
+// Like EnumerateTransitions(), but every transition is only computed temporarily
+// and its successors are appended to the graph. The state space is worked off
+// in rounds of BUILD_BLOCK states (or one row, if that is longer) per thread:
+// the threads collect the successors of their block into a buffer of their own,
+// then the buffers are appended to the graph in index order. This bounds the
+// transient memory. The row buffers of the threads are allocated once, for all
+// rounds.
+// ---------------------------------------------------------------------------------
+
+const long BUILD_BLOCK = 1L << 16;
+
+void Searcher::BuildSuccessorGraph(void) {
+  if (TotalStates()-1>0x7FFFFFFFL) {
+    std::cerr << "Searcher::BuildSuccessorGraph(): Too many states" << std::endl << std::flush;
+    abort();
+  }
+  graph = new SuccessorGraph(TotalStates());
+  unsigned char *lastPaths = LastPencilPaths();
+  long           length    = RowLength();
+  long           roundSize = std::max(BUILD_BLOCK/length,1L)*length*threads;
+  StateIndex    *buffer    = new StateIndex[roundSize*MAX_SUCCESSORS];
+  unsigned char *counts    = new unsigned char[roundSize];
+  Transition    *rows      = new Transition[length*threads];
+  unsigned long long **scratch = new unsigned long long *[threads];
+  for (int t=0;t<threads;t++) {
+    scratch[t] = RowScratch();
+  }
+  for (long roundFrom=0;roundFrom<TotalStates();roundFrom+=roundSize) {
+    long roundTo = roundFrom+roundSize;
+    if (roundTo>TotalStates()) roundTo=TotalStates();
+    ParallelFor(roundFrom/length,roundTo/length,threads,[this,roundFrom,buffer,counts,lastPaths,length,rows,scratch](long from,long to,int t) {
+      Transition *trs = rows+t*length;
+      for (long row=from;row<to;row++) {
+        ComputeTransitionRow(row,lastPaths,scratch[t],trs);
+        for (long index=row*length;index<(row+1)*length;index++) {
+          long slot = index-roundFrom;
+          if (ListedP(index)) {
+            counts[slot] = (unsigned char)TransitionSuccessors(trs[index-row*length],buffer+slot*MAX_SUCCESSORS);
+          }
+          else {
+            counts[slot] = 0;
+          }
+        }
+      }
+    });
+    for (long index=roundFrom;index<roundTo;index++) {
+      long slot = index-roundFrom;
+      graph->AddState();
+      for (int i=0;i<counts[slot];i++) {
+        graph->AddSuccessor(buffer[slot*MAX_SUCCESSORS+i]);
+      }
+    }
+  }
+  for (int t=0;t<threads;t++) {
+    delete[] scratch[t];
+  }
+  delete[] scratch;
+  delete[] rows;
+  delete[] buffer;
+  delete[] counts;
+  delete[] lastPaths;
+  graph->Shrink();
+}
+
+// ---------------------------------------------------------------------------------
+// Get the successors of state 'index' into 'succ' (which must have room for
+// MAX_SUCCESSORS entries) and return their number. Works on 'space' and 'pages'
+// as well as on 'graph'. TransitionSuccessors() does the same for a single
+// "Transition".
+// ---------------------------------------------------------------------------------
+
+int Searcher::TransitionSuccessors(const Transition &trs,StateIndex *succ) const {
+  int count = 0;
+  for (int pencil=0;pencil<State::Pencils();pencil++) {
+    for (int alt=0;alt<2;alt++) {
+      if (alt==1 && !trs.AltNextValidP(pencil)) continue;
+      State next = (alt==0) ? trs.NextState(pencil) : trs.AltNextState(pencil);
+      if (next.IllegalP()) {
+        succ[count++] = SUCCESSOR_ILLEGAL;
+      }
+      else if (next.GoalP()) {
+        succ[count++] = SUCCESSOR_GOAL;
+      }
+      else {
+        succ[count++] = (StateIndex)CanonicalIndex(next);
+      }
+    }
+  }
+  return count;
+}
+
+// ---------------------------------------------------------------------------------
+// The index under which state 's' is searched: its own index, or, if
+// 'symmetric' is set, the smallest index of all its rotations. ListedP() tells
+// whether state 'index' is searched at all, i.e. is a state and is canonical.
+// ---------------------------------------------------------------------------------
+
+long Searcher::CanonicalIndex(const State &s) const {
+  long result = ComputeIndex(s);
+  if (symmetric) {
+    for (int by=1;by<State::Pencils();by++) {
+      long rotated = ComputeIndex(s.Rotated(by));
+      if (rotated<result) result = rotated;
+    }
+  }
+  return result;
+}
+
+inline BOOL Searcher::ListedP(long index) const {
+  if (!State::ValidIndexP(index)) return FALSE;
+  return !symmetric || CanonicalIndex(State::FromIndex(index))==index;
+}
+
+int Searcher::AllSuccessors(long index,StateIndex *succ) {
+  if (graph!=NULL) {
+    const StateIndex *first;
+    int count = graph->Successors(index,first);
+    for (int i=0;i<count;i++) succ[i] = first[i];
+    return count;
+  }
+  else {
+    return TransitionSuccessors(TransitionAt(index),succ);
+  }
+}
+
+// the successors without storing a transition computed for TABLE_LAZY
+int Searcher::FreshSuccessors(long index,StateIndex *succ) {
+  if (tableMode!=TABLE_LAZY) return AllSuccessors(index,succ);
+  Transition trs;
+  ComputeTransition(index,trs);
+  return TransitionSuccessors(trs,succ);
+}
+
+int Searcher::GetSuccessors(long index,StateIndex *succ) {
+  int count = AllSuccessors(index,succ);
+  if (!pruned) return count;
+  // leave out the illegal and the pruned successors
+  int kept = 0;
+  for (int i=0;i<count;i++) {
+    if (succ[i]==SUCCESSOR_GOAL || (succ[i]>=0 && !PrunedP(succ[i]))) succ[kept++] = succ[i];
+  }
+  return kept;
+}
+
+// the successors without the illegal and the dead ones, only reading the tables
+int Searcher::SharedSuccessors(long index,StateIndex *succ) const {
+  int count;
+  if (graph!=NULL) {
+    const StateIndex *first;
+    count = graph->Successors(index,first);
+    for (int i=0;i<count;i++) succ[i] = first[i];
+  }
+  else {
+    count = TransitionSuccessors(space[index],succ);
+  }
+  int kept = 0;
+  for (int i=0;i<count;i++) {
+    if (succ[i]==SUCCESSOR_GOAL) succ[kept++] = succ[i];
+    else if (succ[i]>=0 && (!pruned || liveness[succ[i]]!=LIVE_REACHED)) succ[kept++] = succ[i];
+  }
+  return kept;
+}
+
+// ---------------------------------------------------------------------------------
+// The marks of Prune() of state 'index', and whether it is left out of a search
+// from 'origin'
+// ---------------------------------------------------------------------------------
+
+inline unsigned char Searcher::Liveness(long index) const {
+  if (tableMode==TABLE_LAZY) {
+    const LazyPage *page = pages[index>>LAZY_PAGE_BITS];
+    return (page==NULL) ? 0 : page->liveness[index & (LAZY_PAGE_SIZE-1)];
+  }
+  return liveness[index];
+}
+
+inline BOOL Searcher::PrunedP(long index) const {
+  if (!pruned) return FALSE;
+  if (pruneAll) return (Liveness(index) & LIVE_TO_GOAL)==0;
+  return Liveness(index)==LIVE_REACHED;
+}
+
+void Searcher::SetOrigin(const State &start) {
+  origin   = start;
+  pruneAll = pruned && CanonicalIndex(start)==pruneStart;
+}
+
+// ---------------------------------------------------------------------------------
+// Mark the states reached from the start state and, among them, those from
+// which the goal can be reached (see "Searcher"). A breadth-first search from
+// the start state collects the states reached and the edges between them;
+// sorted by their target, the edges then give the predecessors for a search
+// backward from the states that have a goal state as successor. Only the
+// states reached are ever looked at; with TABLE_LAZY, their marks go to their
+// pages (which the search allocates for them anyway), so that the memory
+// still scales with the states reached.
+// ---------------------------------------------------------------------------------
+
+void Searcher::Prune(void) {
+  typedef std::pair<StateIndex,StateIndex> Edge; // target, source
+  long                    total = TotalStates();
+  long                    start = CanonicalIndex(StartState());
+  unsigned char          *marks = NULL;
+  std::vector<StateIndex> reached;
+  std::vector<StateIndex> toGoal;
+  std::vector<Edge>       edges;
+  StateIndex              succ[MAX_SUCCESSORS];
+  if (tableMode==TABLE_LAZY) {
+    for (long i=0;i<pageCount;i++) {
+      if (pages[i]!=NULL) memset(pages[i]->liveness,0,sizeof(pages[i]->liveness));
+    }
+  }
+  else {
+    marks = new unsigned char[total];
+    memset(marks,0,total);
+  }
+  // the marks of state 'index'
+  auto mark = [this,marks](long index) -> unsigned char & {
+    if (marks!=NULL) return marks[index];
+    return Page(index).liveness[index & (LAZY_PAGE_SIZE-1)];
+  };
+  mark(start) = LIVE_REACHED;
+  reached.push_back((StateIndex)start);
+  for (size_t head=0;head<reached.size();head++) {
+    long index = reached[head];
+    int  count = AllSuccessors(index,succ);
+    for (int i=0;i<count;i++) {
+      if (succ[i]==SUCCESSOR_GOAL) {
+        if ((mark(index) & LIVE_TO_GOAL)==0) toGoal.push_back((StateIndex)index);
+        mark(index) |= LIVE_TO_GOAL;
+      }
+      else if (succ[i]>=0) {
+        edges.push_back(Edge(succ[i],(StateIndex)index));
+        if (mark(succ[i])==0) {
+          mark(succ[i]) = LIVE_REACHED;
+          reached.push_back(succ[i]);
+        }
+      }
+    }
+  }
+  std::sort(edges.begin(),edges.end());
+  for (size_t head=0;head<toGoal.size();head++) {
+    std::vector<Edge>::const_iterator e = std::lower_bound(edges.begin(),edges.end(),Edge(toGoal[head],-1));
+    for (;e!=edges.end() && e->first==toGoal[head];e++) {
+      if ((mark(e->second) & LIVE_TO_GOAL)==0) {
+        mark(e->second) |= LIVE_TO_GOAL;
+        toGoal.push_back(e->second);
+      }
+    }
+  }
+  delete[] liveness;
+  liveness   = marks;
+  pruned     = TRUE;
+  pruneStart = start;
+  SetOrigin(origin);
+  std::cerr << "Pruning: " << reached.size() << " states reached, " << toGoal.size()
+            << " of them lead to the goal" << std::endl << std::flush;
+}
+
+// ---------------------------------------------------------------------------------
+// Build the reverse successor graph and the list of states that have a goal
+// state as successor, if not done yet. This is a counting sort of all edges by
+// their target: the first pass counts the predecessors of every state, the
+// second pass puts them in place. Illegal successors have no reverse edge.
+// ---------------------------------------------------------------------------------
+
+void Searcher::BuildReverseGraph(void) {
+  if (reverse!=NULL) return;
+  long        total   = TotalStates();
+  EdgeOffset *offsets = new EdgeOffset[total+1];
+  EdgeOffset *cursor  = new EdgeOffset[total];
+  StateIndex  succ[MAX_SUCCESSORS];
+  memset(offsets,0,(total+1)*sizeof(EdgeOffset));
+  preGoalCount = 0;
+  for (long index=0;index<total;index++) {
+    if (!ListedP(index)) continue;
+    int  count = AllSuccessors(index,succ);
+    BOOL goal  = FALSE;
+    for (int i=0;i<count;i++) {
+      if (succ[i]>=0)                 offsets[succ[i]+1]++;
+      else if (succ[i]==SUCCESSOR_GOAL) goal = TRUE;
+    }
+    if (goal) preGoalCount++;
+  }
+  for (long index=0;index<total;index++) {
+    offsets[index+1] += offsets[index];
+    cursor[index]     = offsets[index];
+  }
+  StateIndex *predecessors = (StateIndex *)malloc((offsets[total]>0 ? offsets[total] : 1)*sizeof(StateIndex));
+  if (predecessors==NULL) throw std::bad_alloc();
+  preGoal = new StateIndex[preGoalCount];
+  long preGoalFound = 0;
+  for (long index=0;index<total;index++) {
+    if (!ListedP(index)) continue;
+    int  count = AllSuccessors(index,succ);
+    BOOL goal  = FALSE;
+    for (int i=0;i<count;i++) {
+      if (succ[i]>=0)                 predecessors[cursor[succ[i]]++] = (StateIndex)index;
+      else if (succ[i]==SUCCESSOR_GOAL) goal = TRUE;
+    }
+    if (goal) preGoal[preGoalFound++] = (StateIndex)index;
+  }
+  delete[] cursor;
+  reverse = new SuccessorGraph(total,offsets,predecessors);
+  delete[] offsets;
+}
+
+BOOL Searcher::WriteImage(const char *fileName) {
+  if (graph==NULL) {
+    std::cerr << "Searcher::WriteImage(): Only the successor graph can be written" << std::endl << std::flush;
+    return FALSE;
+  }
+  return MazeImage::Write(fileName,Maze::Current(),*graph,symmetric,std::cerr);
+}
+
+// ---------------------------------------------------------------------------------
+// The bytes taken by the transitions (the transition table, the successor graph
+// or the lazy pages allocated) and the number of states visited by the latest
+// search
+// ---------------------------------------------------------------------------------
+
+long Searcher::TableBytes(void) const {
+  if (tableMode==TABLE_LAZY)    return pagesAllocated*(long)sizeof(LazyPage);
+  if (tableMode==TABLE_COMPACT) return graph->Bytes();
+  return TotalStates()*(long)sizeof(Transition);
+}
+
+long Searcher::VisitedCount(void) const {
+  long count = 0;
+  for (long i=0;i<TotalStates();i++) {
+    if (Visited(i)>0) count++;
+  }
+  return count;
+}
+
+// ---------------------------------------------------------------------------------
+// Dump the transitions of the visited states in format 'format' (see DUMP_...).
+// DUMP_PRETTY goes in the order: movement flags of pencil 0 (moved first), of
+// pencil 1, ..., box of pencil 0, of pencil 1, ..., rule flags (active first),
+// where an earlier item varies slower. The other formats just walk the state
+// space in index order:
+//
+//   DUMP_CSV     a header line, then per state: index, box of every pencil,
+//                movement flags and rule flags (as bit sets, pencil or flag 0
+//                being bit 0), 'visited' and the successors separated by ';'
+//                ("goal", "illegal" or a state index)
+//   DUMP_BINARY  per state a "DumpRecord"
+//
+// The text is collected in a buffer of DUMP_BUFFER_SIZE and written in large
+// pieces; 'os' is flushed at the end only.
+// ---------------------------------------------------------------------------------
+
+void Searcher::DumpTransitions(std::ostream &os,int format) {
+  STATS(StatsTimer timer(stats.dumpSeconds));
+  if (format==DUMP_NONE) {
+    return;
+  }
+  else if (format==DUMP_PRETTY) {
+    DumpPretty(os);
+    return;
+  }
+  std::ostringstream text;
+  long               total   = TotalStates();
+  int                pencils = State::Pencils();
+  StateIndex         succ[MAX_SUCCESSORS];
+  if (format==DUMP_CSV) {
+    text << "index";
+    for (int p=0;p<pencils;p++) text << ",p" << p;
+    text << ",moved,flags,visited,successors\n";
+  }
+  for (long index=0;index<total;index++) {
+    int depth = Visited(index);
+    if (depth<=0) continue;
+    int count = AllSuccessors(index,succ);
+    if (format==DUMP_BINARY) {
+      DumpRecord record;
+      memset(&record,0,sizeof(record));
+      record.index   = (StateIndex)index;
+      record.visited = depth;
+      record.count   = count;
+      for (int i=0;i<count;i++) record.successors[i] = succ[i];
+      text.write((const char *)&record,sizeof(record));
+    }
+    else {
+      State    current = State::FromIndex(index);
+      unsigned moved   = 0;
+      unsigned flagSet = 0;
+      text << index;
+      for (int p=0;p<pencils;p++) {
+        text << "," << current.Pencil(p);
+        if (current.MovementP(p)) moved |= 1u<<p;
+      }
+      for (int f=0;f<State::Flags();f++) {
+        if (current.FlagP(f)) flagSet |= 1u<<f;
+      }
+      text << "," << moved << "," << flagSet << "," << depth << ",";
+      for (int i=0;i<count;i++) {
+        if (i>0) text << ";";
+        if (succ[i]==SUCCESSOR_GOAL)         text << "goal";
+        else if (succ[i]==SUCCESSOR_ILLEGAL) text << "illegal";
+        else                                 text << succ[i];
+      }
+      text << "\n";
+    }
+    if (text.tellp()>=DUMP_BUFFER_SIZE) {
+      os << text.str();
+      text.str("");
+    }
+  }
+  os << text.str() << std::flush;
+}
+
+void Searcher::DumpPretty(std::ostream &os) {
+  std::ostringstream text;
+  const Maze &maze       = Maze::Current();
+  int         pencils    = State::Pencils();
+  int         flags      = State::Flags();
+  long        placements = 1;
+  for (int p=0;p<pencils;p++) placements *= maze.BoxCount();
+  for (long moved=0;moved<(1L<<pencils);moved++) {
+    for (long placement=0;placement<placements;placement++) {
+      for (long flagSet=0;flagSet<(1L<<flags);flagSet++) {
+        State current;
+        long  rest = placement;
+        for (int p=pencils-1;p>=0;p--) {
+          current.SetPencil(p,maze.Number((int)(rest%maze.BoxCount())));
+          current.SetMovement(p,!((moved>>(pencils-1-p)) & 1));
+          rest /= maze.BoxCount();
+        }
+        for (int f=0;f<flags;f++) {
+          current.SetFlag(f,!((flagSet>>(flags-1-f)) & 1));
+        }
+        long index = ComputeIndex(current);
+        assert(index<TotalStates());
+        if (Visited(index)>0) {
+          if (graph==NULL) {
+            text << TransitionAt(index);
+          }
+          else {
+            // the successor graph does not tell which pencil was moved
+            StateIndex succ[MAX_SUCCESSORS];
+            int        count = GetSuccessors(index,succ);
+            text << current << " ->";
+            for (int i=0;i<count;i++) {
+              if (succ[i]==SUCCESSOR_GOAL)         text << " goal";
+              else if (succ[i]==SUCCESSOR_ILLEGAL) text << " illegal";
+              else                                 text << " " << State::FromIndex(succ[i]);
+            }
+            text << " ";
+          }
+          text << " visited: " << Visited(index) << "\n";
+          if (text.tellp()>=DUMP_BUFFER_SIZE) {
+            os << text.str();
+            text.str("");
+          }
+        }
+      }
+    }
+  }
+  os << text.str() << std::flush;
+}
+
+void Searcher::DumpPath(long index,const char *title,std::ostream &os) {
+  // follow the parent pointers back to the start, then print the path from the
+  // start on; the depth of 'index' gives the path length
+  int         depth = Visited(index);
+  StateIndex *path  = new StateIndex[depth];
+  for (int i=depth-1;i>=0;i--) {
+    assert(index>=0);
+    path[i] = (StateIndex)index;
+    index   = Parent(index);
+  }
+  PrintPath(path,depth,title,os);
+  delete[] path;
+}
+
+void Searcher::PrintPath(const StateIndex *path,int length,const char *title,std::ostream &os) {
+  State *states = new State[length];
+  for (int i=0;i<length;i++) states[i] = State::FromIndex(path[i]);
+  ConcretePath(states,length);
+  os << "---- " << title << ", depth " << length << "\n";
+  for (int i=0;i<length;i++) {
+    os << states[i] << "\n";
+  }
+  os << std::flush;
+  delete[] states;
+}
+
+// ---------------------------------------------------------------------------------
+// Solve the maze for every start position in file 'fileName', a line with the
+// start box of every pencil per position (empty lines and lines starting with
+// '#' are skipped); the pencils have not moved and all rule flags are off.
+// Prints the depth of a shortest solution per position. Returns FALSE if the
+// file cannot be read or has a bad line.
+// ---------------------------------------------------------------------------------
+
+BOOL Searcher::StartQueries(const char *fileName) {
+  std::ifstream is(fileName);
+  if (!is) {
+    std::cerr << fileName << ": Cannot open start positions" << std::endl << std::flush;
+    return FALSE;
+  }
+  const Maze         &maze = Maze::Current();
+  std::ostringstream  text;
+  std::string         line;
+  long                queries = 0;
+  for (int lineNumber=1;std::getline(is,line);lineNumber++) {
+    State start;
+    if (line.empty() || line[0]=='#') continue;
+    if (!ParseStart(line,start)) {
+      std::cerr << fileName << ":" << lineNumber << ": Expected the start boxes of "
+                << maze.PencilCount() << " pencils" << std::endl << std::flush;
+      return FALSE;
+    }
+    int length = Solve(start);
+    for (int p=0;p<maze.PencilCount();p++) text << (p==0 ? "" : " ") << start.Pencil(p);
+    if (length>0) text << ": depth " << length << "\n";
+    else          text << ": unreachable\n";
+    queries++;
+  }
+  std::cerr << queries << " start positions solved" << std::endl << std::flush;
+  std::cout << text.str() << std::flush;
+  return TRUE;
+}
+
+// ---------------------------------------------------------------------------------
+// Read the start box of every pencil from 'line' into 'start', with the pencils
+// not moved and all rule flags off; returns FALSE unless 'line' holds exactly
+// one box number per pencil.
+// ---------------------------------------------------------------------------------
+
+BOOL Searcher::ParseStart(const std::string &line,State &start) {
+  const Maze         &maze = Maze::Current();
+  std::istringstream  words(line);
+  int                 number;
+  int                 p = 0;
+  while (p<maze.PencilCount() && !(words >> number).fail()) {
+    if (!maze.BoxP(number)) break;
+    start.SetPencil(p,number);
+    start.SetMovement(p,FALSE);
+    p++;
+  }
+  if (p<maze.PencilCount() || !(words >> std::ws).eof()) return FALSE;
+  for (int f=0;f<maze.FlagCount();f++) start.SetFlag(f,FALSE);
+  return TRUE;
+}
+
+// ---------------------------------------------------------------------------------
+// Serve queries from 'is' until its end: every line holds the start boxes of
+// the pencils, as in StartQueries(), and a batch of queries ends with an empty
+// line (or the end of 'is'); lines starting with '#' are skipped, and a batch
+// is answered after SERVICE_BATCH_LIMIT queries even without an empty line, so
+// that a stream never piles up more than that. The queries
+// of a batch are split among 'threads' threads, each solving its share with
+// SolveShared() in an arena of its own (see "SearchArena"), and the answers
+// are written to 'os' in the order of the queries, one line each with the
+// start boxes and the depth of a shortest solution, "unreachable" or "error"
+// for a bad line; 'os' is flushed after each batch. A thread gets its arena
+// with its first query and keeps it for all batches, so a thread that is never
+// given a query (with fewer queries than threads) takes no memory. Returns FALSE
+// for TABLE_LAZY, whose tables cannot be shared. ServeQueries() does the work
+// with 'workers' threads; it only reads the tables, so several of them may run
+// at the same time (see StartListening()).
+// ---------------------------------------------------------------------------------
+
+const long SERVICE_BATCH_LIMIT = 1L << 16;
+
+BOOL Searcher::StartService(std::istream &is,std::ostream &os) {
+  if (tableMode==TABLE_LAZY) {
+    std::cerr << "The service needs the transitions computed up front (not -lazy)" << std::endl << std::flush;
+    return FALSE;
+  }
+  ServeQueries(is,os,threads);
+  return TRUE;
+}
+
+void Searcher::ServeQueries(std::istream &is,std::ostream &os,int workers) const {
+  const Maze               &maze   = Maze::Current();
+  SearchArena             **arenas = new SearchArena*[workers];
+  std::vector<std::string>  lines;
+  std::string               line;
+  long                      queries = 0;
+  long                      batches = 0;
+  BOOL                      more    = TRUE;
+  for (int t=0;t<workers;t++) arenas[t] = NULL;
+  while (more) {
+    lines.clear();
+    while ((long)lines.size()<SERVICE_BATCH_LIMIT &&
+           (more = !std::getline(is,line).fail()) && !line.empty()) {
+      if (line[0]!='#') lines.push_back(line);
+    }
+    if (lines.empty()) continue;
+    std::vector<std::string> answers(lines.size());
+    ParallelFor(0,(long)lines.size(),workers,[&](long from,long to,int t) {
+      if (from<to && arenas[t]==NULL) arenas[t] = new SearchArena(TotalStates());
+      for (long q=from;q<to;q++) {
+        std::ostringstream text;
+        State              start;
+        if (!ParseStart(lines[q],start)) {
+          text << lines[q] << ": error, expected the start boxes of "
+               << maze.PencilCount() << " pencils\n";
+        }
+        else {
+          int length = SolveShared(*arenas[t],start);
+          for (int p=0;p<maze.PencilCount();p++) text << (p==0 ? "" : " ") << start.Pencil(p);
+          if (length>0) text << ": depth " << length << "\n";
+          else          text << ": unreachable\n";
+        }
+        answers[q] = text.str();
+      }
+    });
+    for (size_t q=0;q<answers.size();q++) os << answers[q];
+    os << std::flush;
+    queries += (long)lines.size();
+    batches++;
+  }
+  for (int t=0;t<workers;t++) delete arenas[t];
+  delete[] arenas;
+  std::cerr << queries << " queries in " << batches << " batches served" << std::endl << std::flush;
+}
+
+// ---------------------------------------------------------------------------------
+// The stream buffer of a connected socket, for StartListening(): reads what
+// has arrived, and sends what is written when it is flushed or full. A peer
+// that has gone away ends the input and fails the output (without SIGPIPE),
+// and so does one that has been silent for the receive timeout of the socket
+// or sends a line longer than SOCKET_LINE_LIMIT.
+// ---------------------------------------------------------------------------------
+
+const int  SOCKET_BUFFER     = 1 << 14;
+const long SOCKET_LINE_LIMIT = 1 << 10;
+
+class SocketBuffer : public std::streambuf {
+  int  socket;
+  long lineLength;
+  char in[SOCKET_BUFFER];
+  char out[SOCKET_BUFFER];
+public:
+  SocketBuffer(int socketIn) : socket(socketIn), lineLength(0) {
+    setg(in,in,in);
+    setp(out,out+SOCKET_BUFFER);
+  }
+  ~SocketBuffer(void) { Send(); }
+protected:
+  int underflow(void) {
+    ssize_t got;
+    do got = read(socket,in,SOCKET_BUFFER); while (got<0 && errno==EINTR);
+    if (got<=0) return traits_type::eof();
+    for (ssize_t i=0;i<got;i++) {
+      lineLength = (in[i]=='\n') ? 0 : lineLength+1;
+      if (lineLength>SOCKET_LINE_LIMIT) return traits_type::eof();
+    }
+    setg(in,in,in+got);
+    return traits_type::to_int_type(in[0]);
+  }
+  int overflow(int c) {
+    if (Send()!=0) return traits_type::eof();
+    if (c!=traits_type::eof()) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+  int sync(void) { return Send(); }
+private:
+  int Send(void) {
+    char *from = pbase();
+    while (from<pptr()) {
+      ssize_t sent = send(socket,from,pptr()-from,MSG_NOSIGNAL);
+      if (sent<0 && errno==EINTR) continue;
+      if (sent<=0) return -1;
+      from += sent;
+    }
+    setp(out,out+SOCKET_BUFFER);
+    return 0;
+  }
+};
+
+// ---------------------------------------------------------------------------------
+// Serve queries over TCP: listen on 'address', "port" or "addr:port" (without
+// an address only on the loopback interface, as the service has no
+// authentication; port 0: a port chosen by the system, which is printed), and
+// run ServeQueries() on every connection accepted, until the process is
+// stopped. Every connection is served on a thread of its own, so the clients
+// share the tables and do not wait for each other; up to 'threads' of them are
+// served at the same time (each takes an arena, see "SearchArena"), further
+// ones wait to be accepted. A client silent for LISTEN_TIMEOUT seconds, or
+// not reading its answers for as long, is disconnected. Returns FALSE if the
+// socket cannot be set up or accepting fails (after the connections being
+// served have ended), or for TABLE_LAZY.
+// ---------------------------------------------------------------------------------
+
+const int LISTEN_TIMEOUT = 60;
+
+BOOL Searcher::StartListening(const char *where) {
+  if (tableMode==TABLE_LAZY) {
+    std::cerr << "The service needs the transitions computed up front (not -lazy)" << std::endl << std::flush;
+    return FALSE;
+  }
+  struct sockaddr_in address;
+  socklen_t          length = sizeof(address);
+  const char        *colon  = strrchr(where,':');
+  const char        *digits = (colon!=NULL) ? colon+1 : where;
+  char              *end;
+  long               port   = strtol(digits,&end,10);
+  memset(&address,0,sizeof(address));
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (colon!=NULL) {
+    std::string host(where,colon-where);
+    if (inet_pton(AF_INET,host.c_str(),&address.sin_addr)!=1) {
+      std::cerr << where << ": No such address" << std::endl << std::flush;
+      return FALSE;
+    }
+  }
+  if (*digits=='\0' || *end!='\0' || port<0 || 65535<port) {
+    std::cerr << where << ": No such port" << std::endl << std::flush;
+    return FALSE;
+  }
+  address.sin_port = htons((unsigned short)port);
+  int server = socket(AF_INET,SOCK_STREAM,0);
+  int reuse  = 1;
+  if (server<0 || setsockopt(server,SOL_SOCKET,SO_REUSEADDR,&reuse,sizeof(reuse))!=0 ||
+      bind(server,(struct sockaddr *)&address,sizeof(address))!=0 || listen(server,16)!=0 ||
+      getsockname(server,(struct sockaddr *)&address,&length)!=0) {
+    std::cerr << where << ": Cannot listen (" << strerror(errno) << ")" << std::endl << std::flush;
+    if (server>=0) close(server);
+    return FALSE;
+  }
+  char host[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET,&address.sin_addr,host,sizeof(host));
+  std::cerr << "Listening on " << host << " port " << ntohs(address.sin_port) << std::endl << std::flush;
+  std::mutex              lock;
+  std::condition_variable done;
+  int                     active = 0;
+  BOOL                    ok     = TRUE;
+  while (ok) {
+    {
+      // wait for a free slot before accepting the next client
+      std::unique_lock<std::mutex> guard(lock);
+      done.wait(guard,[&] { return active<threads; });
+    }
+    int connection = accept(server,NULL,NULL);
+    if (connection<0) {
+      if (errno==EINTR || errno==ECONNABORTED) continue;
+      std::cerr << where << ": Cannot accept (" << strerror(errno) << ")" << std::endl << std::flush;
+      ok = FALSE;
+      continue;
+    }
+    struct timeval timeout;
+    timeout.tv_sec  = LISTEN_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(connection,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+    setsockopt(connection,SOL_SOCKET,SO_SNDTIMEO,&timeout,sizeof(timeout));
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      active++;
+    }
+    std::thread([this,connection,&lock,&done,&active] {
+      {
+        // two streams, as the end of the input must not fail the output
+        SocketBuffer buffer(connection);
+        std::istream input(&buffer);
+        std::ostream output(&buffer);
+        ServeQueries(input,output,1);
+      }
+      close(connection);
+      std::lock_guard<std::mutex> guard(lock);
+      active--;
+      done.notify_all();
+    }).detach();
+  }
+  close(server);
+  std::unique_lock<std::mutex> guard(lock);
+  done.wait(guard,[&] { return active==0; });
+  return FALSE;
+}
+
+// ---------------------------------------------------------------------------------
+// Compare the tables and the shortest searches with the compile-time solution of
+// the built-in maze (see "BuiltinSolution"), which must be the installed maze.
+// Every transition must have the successors of BUILTIN_TABLE, and the
+// breadth-first, bidirectional and A* searches must find a solution of the
+// length of BUILTIN_SOLUTION; every state the breadth-first search visits must
+// be at its compile-time depth, and every solution found must be a path of
+// BUILTIN_TABLE from the start state to the goal. With 'symmetric', the states
+// are canonical and only the lengths are compared. Prints a line per check;
+// returns FALSE if any of them fails.
+// ---------------------------------------------------------------------------------
+
+BOOL Searcher::CheckBuiltin(void) {
+  if (!BuiltinMazeP(Maze::Current()) || TotalStates()!=BUILTIN_STATES) {
+    std::cerr << "The compile-time solution is only known for the built-in maze" << std::endl << std::flush;
+    return FALSE;
+  }
+  // is 'path' a solution on the compile-time table?
+  auto validPath = [](const StateIndex *path,int length) {
+    auto successorP = [](long from,StateIndex to) {
+      for (int i=0;i<BUILTIN_TABLE.count[from];i++) {
+        if (BUILTIN_TABLE.succ[from][i]==to) return TRUE;
+      }
+      return FALSE;
+    };
+    if (length==0 || path[0]!=BuiltinStartIndex()) return FALSE;
+    for (int i=1;i<length;i++) {
+      if (!successorP(path[i-1],path[i])) return FALSE;
+    }
+    return successorP(path[length-1],SUCCESSOR_GOAL);
+  };
+  int         expected = BUILTIN_SOLUTION.length;
+  long        total    = TotalStates();
+  StateIndex *path     = new StateIndex[total];
+  BOOL        ok       = TRUE;
+  std::cout << "Compile time: depth " << expected << ", "
+            << BUILTIN_SOLUTION.reached << " states reachable" << std::endl;
+  if (symmetric) {
+    std::cout << "Transitions: not compared (symmetric)" << std::endl;
+  }
+  else {
+    long differ = 0;
+    for (long index=0;index<total;index++) {
+      StateIndex succ[MAX_SUCCESSORS];
+      int        count = AllSuccessors(index,succ);
+      BOOL       same  = count==BUILTIN_TABLE.count[index];
+      for (int i=0;i<count && same;i++) same = succ[i]==BUILTIN_TABLE.succ[index][i];
+      if (!same) differ++;
+    }
+    std::cout << "Transitions: " << differ << " of " << total << " states differ" << std::endl;
+    ok = ok && differ==0;
+  }
+  const char *name[3] = { "Breadth-first search","Bidirectional search","A* search" };
+  for (int engine=0;engine<3;engine++) {
+    int  length    = 0;
+    int  maxDepth  = 0;
+    long last      = -1;
+    long expanded  = 0;
+    long elsewhere = 0;
+    if (engine==0) {
+      last = ShortestSearch(StartState(),maxDepth);
+      for (long index=0;index<total && !symmetric;index++) {
+        if (Visited(index)>0 && Visited(index)!=BUILTIN_SOLUTION.depth[index]) elsewhere++;
+      }
+    }
+    else if (engine==1) {
+      Reset();
+      SetOrigin(StartState());
+      std::vector<StateIndex> halves;
+      length = BidirectionalTraverse(CanonicalIndex(origin),halves);
+      std::copy(halves.begin(),halves.end(),path);
+    }
+    else {
+      Reset();
+      SetOrigin(StartState());
+      last = AStarTraverse(CanonicalIndex(origin),expanded);
+    }
+    if (last>=0) {
+      // the parent pointers back to the start, as DumpPath() follows them
+      length = Visited(last);
+      for (int i=length-1;i>=0;i--) {
+        path[i] = (StateIndex)last;
+        last    = Parent(last);
+      }
+    }
+    BOOL valid = symmetric || length==0 || validPath(path,length);
+    std::cout << name[engine] << ": depth " << length;
+    if (engine==0 && !symmetric) std::cout << ", " << elsewhere << " states at another depth";
+    if (!valid)                  std::cout << ", not a solution";
+    std::cout << std::endl;
+    ok = ok && length==expected && elsewhere==0 && valid;
+  }
+  solution = -1;
+  delete[] path;
+  std::cout << (ok ? "The tables and searches agree with the compile-time solution"
+                   : "The tables and searches DISAGREE with the compile-time solution") << std::endl << std::flush;
+  return ok;
+}
+
+// ---------------------------------------------------------------------------------
+// Bring the tables up to date after the rule of the box with index 'box' has
+// been edited (see "Searcher"); returns the number of transitions recomputed.
+// 'kept' tells whether the latest search still holds. The reverse graph is
+// dropped, to be built anew when needed, and the pruning (see Prune()) is
+// done again.
+// ---------------------------------------------------------------------------------
+
+long Searcher::Edit(int box,BOOL &kept) {
+  int  length  = (solution<0) ? INT_MAX : Visited(solution);
+  long changed = 0;
+  kept = TRUE;
+  for (int p=0;p<State::Pencils();p++) {
+    for (long i=0;i<State::BoxStates();i++) {
+      long index = State::IndexWithBox(i,p,box);
+      if (!ListedP(index)) continue;
+      // a state with several pencils at the box is taken for the first of them
+      State s = State::FromIndex(index);
+      int   q = 0;
+      while (s.BoxIndex(q)!=box) q++;
+      if (q<p) continue;
+      int depth = Visited(index);
+      if (index==solution || (depth>0 && depth<length)) kept = FALSE;
+      if (tableMode==TABLE_LAZY) {
+        LazyPage *page = pages[index>>LAZY_PAGE_BITS];
+        long      slot = index & (LAZY_PAGE_SIZE-1);
+        if (page!=NULL && page->computed[slot]) {
+          page->computed[slot] = 0;
+          lazyComputed--;
+        }
+      }
+      else {
+        ComputeTransition(index,space[index]);
+      }
+      changed++;
+    }
+  }
+  delete reverse;
+  delete[] preGoal;
+  delete[] boxDistance;
+  reverse      = NULL;
+  preGoal      = NULL;
+  preGoalCount = 0;
+  boxDistance  = NULL;
+  if (pruned) {
+    Prune();
+    kept = FALSE;
+  }
+  return changed;
+}
+
+// ---------------------------------------------------------------------------------
+// Solve the maze, then apply the box edits in file 'fileName' to 'maze' (the
+// installed maze) one by one, each a "box" line of the maze description format
+// (empty lines and lines starting with '#' are skipped). After every edit, the
+// tables are brought up to date and the maze is solved again if the solution
+// may have changed. Prints a line per edit with the number of transitions
+// recomputed, the new depth and the time the update took. Returns FALSE if
+// 'maze' is not the installed maze, the file cannot be read or has a bad edit.
+// ---------------------------------------------------------------------------------
+
+BOOL Searcher::StartEditing(Maze &maze,const char *fileName) {
+  typedef std::chrono::steady_clock Clock;
+  if (&maze!=&Maze::Current()) {
+    std::cerr << "Searcher::StartEditing(): The maze is not the installed one" << std::endl << std::flush;
+    return FALSE;
+  }
+  if (tableMode==TABLE_COMPACT) {
+    std::cerr << "Searcher::StartEditing(): The successor graph cannot be edited" << std::endl << std::flush;
+    return FALSE;
+  }
+  std::ifstream is(fileName);
+  if (!is) {
+    std::cerr << fileName << ": Cannot open edits" << std::endl << std::flush;
+    return FALSE;
+  }
+  std::string line;
+  int         length = Solve(StartState());
+  std::cout << "unedited: ";
+  if (length>0) std::cout << "depth " << length << "\n";
+  else          std::cout << "unreachable\n";
+  for (int lineNumber=1;std::getline(is,line);lineNumber++) {
+    std::ostringstream where;
+    int                box;
+    BOOL               kept;
+    if (line.empty() || line[0]=='#') continue;
+    where << fileName << ":" << lineNumber;
+    if (!maze.Edit(line,where.str().c_str(),std::cerr,box)) return FALSE;
+    Clock::time_point begin   = Clock::now();
+    long              changed = Edit(box,kept);
+    if (!kept) length = Solve(StartState());
+    double seconds = std::chrono::duration<double>(Clock::now()-begin).count();
+    char   text[128];
+    snprintf(text,sizeof(text),"box %d: %ld transitions recomputed, ",maze.Number(box),changed);
+    std::cout << text;
+    if (length>0) std::cout << "depth " << length;
+    else          std::cout << "unreachable";
+    snprintf(text,sizeof(text)," (%s, %.3f ms)\n",kept ? "kept" : "solved again",seconds*1e3);
+    std::cout << text;
+  }
+  PrintSolution(std::cout);
+  return TRUE;
+}
+
+// ---------------------------------------------------------------------------------
+// Count the shortest solutions and print the first 'listLimit' of them
+// ---------------------------------------------------------------------------------
+
+void Searcher::StartCounting(long listLimit) {
+  STATS(StatsTimer timer(stats.searchSeconds));
+  Reset();
+  SetOrigin(StartState());
+  ShortestSolutions solutions(*this,CanonicalIndex(origin));
+  int               length = solutions.Length();
+  if (length==0) {
+    std::cerr << "Goal state cannot be reached!" << std::endl << std::flush;
+    return;
+  }
+  std::cerr << "Goal state encountered at " << length << "!" << std::endl << std::flush;
+  std::cout << "Number of shortest solutions (depth " << length << "): "
+            << solutions.Count() << (solutions.Saturated() ? " or more" : "") << "\n";
+  StateIndex *path = new StateIndex[length];
+  for (long n=0;n<listLimit && solutions.Next(path);n++) {
+    PrintPath(path,length,"Shortest solution",std::cout);
+  }
+  std::cout << std::flush;
+  delete[] path;
+}
+
+// ---------------------------------------------------------------------------------
+// Map a path of canonical states from the start state (see 'symmetric') back to
+// the states the pencils actually go through: starting from the concrete start
+// state, every step takes the successor whose canonical state is the next one on
+// the path. The successors of concrete states are computed on the spot, as
+// those states need not be in any table.
+// ---------------------------------------------------------------------------------
+
+void Searcher::ConcretePath(State *path,int length) {
+  if (!symmetric || length==0) return;
+  assert(CanonicalIndex(origin)==path[0].Index());
+  path[0] = origin;
+  for (int i=1;i<length;i++) {
+    Transition trs;
+    long       wanted = path[i].Index();
+    BOOL       found  = FALSE;
+    ComputeTransition(path[i-1].Index(),trs);
+    for (int p=0;p<State::Pencils() && !found;p++) {
+      for (int alt=0;alt<2 && !found;alt++) {
+        if (alt==1 && !trs.AltNextValidP(p)) continue;
+        State next = (alt==0) ? trs.NextState(p) : trs.AltNextState(p);
+        if (!next.IllegalP() && !next.GoalP() && CanonicalIndex(next)==wanted) {
+          path[i] = next;
+          found   = TRUE;
+        }
+      }
+    }
+    if (!found) {
+      std::cerr << "Searcher::ConcretePath(): Path is broken" << std::endl << std::flush;
+      abort();
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Determine the exit path (PATH_YES, PATH_NO, PATH_LUGNUT or PATH_NONE) taken if
+// the rule in the box of 'chosenPencil' is applied in state 'current'. This
+// evaluates the box's rule in the installed maze: predicates are tests of the
+// property words of the boxes (see Maze::Properties()). A counterfactual rule
+// depends on the exit path of the other pencil and is not decided here
+// (PATH_NONE is returned), see ExitPaths().
+// ---------------------------------------------------------------------------------
+
+int Searcher::DirectExitPath(int chosenPencil,const State &current) {
+  const Maze    &maze        = Maze::Current();
+  int            otherPencil = OtherPencil(chosenPencil);
+  int            self        = current.BoxIndex(chosenPencil);
+  int            other       = current.BoxIndex(otherPencil);
+  const BoxRule &rule        = maze.Rule(self);
+  if (current.Rule60P() && (maze.Properties(self) & PROP_RED_TEXT)) {
+    // ignore red text, just move through 'Yes'
+    return PATH_YES;
+  }
+  switch (rule.kind) {
+  case RULE_OTHER_HAS:
+    return maze.OtherYesP(self,other) ? PATH_YES : PATH_NO;
+  case RULE_SELF_HAS:
+    return (maze.Properties(self) & rule.mask) ? PATH_YES : PATH_NO;
+  case RULE_OTHER_MOVED:
+    return current.MovementP(otherPencil) ? PATH_YES : PATH_NO;
+  case RULE_COUNTERFACTUAL:
+    return PATH_NONE;
+  case RULE_CHOICE:
+    return PATH_LUGNUT;
+  case RULE_ALWAYS:
+    return PATH_YES;
+  case RULE_FLAG_SET:
+    return current.FlagP(rule.flag) ? PATH_YES : PATH_NO;
+  default:
+    std::cerr << "Searcher::DirectExitPath(): No such rule kind" << std::endl << std::flush;
+    abort();
+    return PATH_NONE; // keeps compiler happy
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Record the exit paths of all pencils in 'trs', whose current state must be
+// set. The rules that do not depend on the other pencil are evaluated first;
+// a counterfactual rule then just looks up the exit path recorded for the other
+// pencil (ResolveCounterfactuals(), on the exit paths 'paths' of all pencils,
+// where 'counterfactual' tells which boxes ask). If the other pencil's box asks
+// the same question, it is asked about the pencil after that, and so on: every
+// counterfactual box on the way turns the answer around. This need not be
+// feasible: if all pencils' boxes ask that question, there's a deadly embrace
+// (PATH_NONE).
+// ---------------------------------------------------------------------------------
+
+void Searcher::ExitPaths(Transition &trs) {
+  const Maze    &maze    = Maze::Current();
+  const State   &current = trs.CurrentState();
+  int            pencils = State::Pencils();
+  BOOL           counterfactual[MAX_PENCILS] = { FALSE };
+  unsigned char  paths[MAX_PENCILS];
+  for (int p=0;p<pencils;p++) {
+    counterfactual[p] = maze.Rule(current.BoxIndex(p)).kind==RULE_COUNTERFACTUAL &&
+                        !(current.Rule60P() && (maze.Properties(current.BoxIndex(p)) & PROP_RED_TEXT));
+    paths[p] = (unsigned char)DirectExitPath(p,current);
+  }
+  ResolveCounterfactuals(counterfactual,paths);
+  for (int p=0;p<pencils;p++) {
+    trs.SetExitPath(p,paths[p]);
+  }
+}
+
+void Searcher::ResolveCounterfactuals(const BOOL *counterfactual,unsigned char *paths) {
+  for (int p=0;p<State::Pencils();p++) {
+    if (!counterfactual[p]) continue;
+    int  other  = OtherPencil(p);
+    BOOL invert = TRUE;
+    while (other!=p && counterfactual[other]) {
+      other  = OtherPencil(other);
+      invert = !invert;
+    }
+    if (other==p) {
+      paths[p] = PATH_NONE;
+    }
+    else if (invert) {
+      paths[p] = (paths[other]==PATH_NO) ? PATH_YES : PATH_NO;
+    }
+    else {
+      paths[p] = (paths[other]==PATH_NO) ? PATH_NO : PATH_YES;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Recursively traverse the state space
+// ---------------------------------------------------------------------------------
+// 'from' is the state 'index' is entered from (-1 for the start state); it is
+// stored as parent whenever a state is (re)entered. A state on the recursion
+// stack is never re-entered, as that would need a depth smaller than its own
+// and all states below it on the stack are deeper. The parents of the states on
+// the stack therefore form the stack itself, and a path found is reconstructed
+// by DumpPath() without a depth limit. Every goal reached is reported on the
+// standard error, but only the paths of at most TRACE_DEPTH moves (the depth of
+// the puzzle's shortest solution) are printed, unless 'allTraces' is set.
+// ---------------------------------------------------------------------------------
+
+void Searcher::StartTraversal(BOOL allTraces) {
+  STATS(StatsTimer timer(stats.searchSeconds));
+  int maxDepth = 0;
+  traceDepth = allTraces ? INT_MAX : TRACE_DEPTH;
+  Reset();
+  SetOrigin(StartState());
+  RecTraverse(CanonicalIndex(origin),-1,1,maxDepth);
+  std::cout << "The maximal search depth encountered is " << maxDepth << std::endl << std::flush;
+}
+
+void Searcher::RecTraverse(long index,StateIndex from,int depth,int &maxDepth) {
+  if (Visited(index)>0 && Visited(index)<=depth) {
+    // we have been here earlier
+    STATS(stats.duplicates++);
+    return;
+  }
+  else {
+    STATS(if (Visited(index)>0) stats.reexpanded++);
+    STATS(stats.Expanded(depth));
+    // store the current depth and where we came from here
+    SetVisited(index,depth);
+    SetParent(index,from);
+    // record a maximal depth value
+    if (maxDepth<depth) maxDepth=depth;
+    // test all possible movements from here...
+    StateIndex succ[MAX_SUCCESSORS];
+    int        count = GetSuccessors(index,succ);
+    for (int i=0;i<count;i++) {
+      if (succ[i]==SUCCESSOR_ILLEGAL) {
+        // no use continuing
+        STATS(stats.illegalHits++);
+        std::cerr << "Illegal state encountered!" << std::endl << std::flush;
+        return;
+      }
+      else if (succ[i]==SUCCESSOR_GOAL) {
+        // no use continuing
+        STATS(stats.goalHits++);
+        std::cerr << "Goal state encountered at " << depth << "!" << std::endl << std::flush;
+        // dump this
+        if (depth<=traceDepth) DumpPath(index,"Stack trace",std::cout);
+        return;
+      }
+      else {
+        RecTraverse(succ[i],(StateIndex)index,depth+1,maxDepth);
+      }
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Iteratively traverse the state space breadth-first
+// ---------------------------------------------------------------------------------
+// Every transition is expanded at most once: the 'visited' value is set to the
+// BFS depth when the state is put on the frontier and is never changed
+// afterwards. The frontier is a vector used as a FIFO queue, each state is
+// enqueued at most once; it grows with the states reached, so that it does not
+// undo the savings of TABLE_LAZY on large state spaces. 'parent' receives,
+// for every visited state, the index of the state it was reached from (-1 for
+// the start state). Successors that are illegal are skipped, they do not stop
+// the expansion of the other successors. Returns the index of the first state
+// found that has a goal state as successor (which is a state of minimal depth)
+// or -1 if the goal cannot be reached.
+// ---------------------------------------------------------------------------------
+
+void Searcher::StartBfsTraversal(void) {
+  int  maxDepth = 0;
+  long last     = ShortestSearch(StartState(),maxDepth);
+  if (last<0) {
+    std::cerr << "Goal state cannot be reached!" << std::endl << std::flush;
+  }
+  else {
+    std::cerr << "Goal state encountered at " << Visited(last) << "!" << std::endl << std::flush;
+    DumpPath(last,"Shortest path",std::cout);
+  }
+  std::cout << "The maximal search depth encountered is " << maxDepth << std::endl << std::flush;
+}
+
+// ---------------------------------------------------------------------------------
+// Forget the previous search (see "Searcher")
+// ---------------------------------------------------------------------------------
+
+void Searcher::Reset(void) {
+  solution = -1;
+  if (visitedTop>INT_MAX/2) {
+    // the depths of the next searches might overflow, really clear the column
+    if (tableMode==TABLE_LAZY) {
+      for (long i=0;i<pageCount;i++) {
+        if (pages[i]!=NULL) memset(pages[i]->visited,0,sizeof(pages[i]->visited));
+      }
+    }
+    else {
+      memset(visited,0,TotalStates()*sizeof(int));
+    }
+    visitedTop = 0;
+  }
+  visitedBase = visitedTop;
+}
+
+// ---------------------------------------------------------------------------------
+// Search a shortest solution from state 'start' after a Reset(), with the
+// parallel breadth-first search where it may be used; returns what
+// BfsTraverse() does
+// ---------------------------------------------------------------------------------
+
+long Searcher::ShortestSearch(const State &start,int &maxDepth) {
+  STATS(StatsTimer timer(stats.searchSeconds));
+  Reset();
+  SetOrigin(start);
+  if (start.IllegalP() || start.GoalP()) return -1;
+  if (threads>1 && tableMode!=TABLE_LAZY) {
+    return ParallelBfsTraverse(CanonicalIndex(start),maxDepth);
+  }
+  return BfsTraverse(CanonicalIndex(start),maxDepth);
+}
+
+// ---------------------------------------------------------------------------------
+// Find a shortest solution from state 'start' on the tables built; returns its
+// number of states (0 if the goal cannot be reached from 'start'). This may be
+// called any number of times; PrintSolution() prints the solution last found.
+// ---------------------------------------------------------------------------------
+
+int Searcher::Solve(const State &start) {
+  int maxDepth = 0;
+  solution = ShortestSearch(start,maxDepth);
+  return (solution<0) ? 0 : Visited(solution);
+}
+
+void Searcher::PrintSolution(std::ostream &os) {
+  if (solution>=0) DumpPath(solution,"Shortest path",os);
+}
+
+// ---------------------------------------------------------------------------------
+// Find the number of states of a shortest solution from state 'start' (0 if
+// the goal cannot be reached) with a breadth-first search in 'arena', which
+// leaves the searcher as it is; the tables must not be TABLE_LAZY
+// ---------------------------------------------------------------------------------
+
+int Searcher::SolveShared(SearchArena &arena,const State &start) const {
+  if (start.IllegalP() || start.GoalP()) return 0;
+  std::vector<StateIndex> &queue = arena.Queue();
+  size_t                   head  = 0;
+  long                     first = CanonicalIndex(start);
+  arena.Reset();
+  arena.SetVisited(first,1);
+  queue.push_back((StateIndex)first);
+  while (head<queue.size()) {
+    long       index = queue[head++];
+    int        depth = arena.Visited(index);
+    StateIndex succ[MAX_SUCCESSORS];
+    int        count = SharedSuccessors(index,succ);
+    for (int i=0;i<count;i++) {
+      if (succ[i]==SUCCESSOR_GOAL) return depth;
+      if (arena.Visited(succ[i])==0) {
+        arena.SetVisited(succ[i],depth+1);
+        queue.push_back(succ[i]);
+      }
+    }
+  }
+  return 0;
+}
+
+long Searcher::BfsTraverse(long startIndex,int &maxDepth) {
+  std::vector<StateIndex> queue;
+  size_t                  head = 0;
+  long                    last = -1;
+  SetVisited(startIndex,1);
+  SetParent(startIndex,-1);
+  queue.push_back((StateIndex)startIndex);
+  STATS(stats.Level(1,1));
+  while (head<queue.size() && last<0) {
+    long index = queue[head++];
+    int  depth = Visited(index);
+    if (maxDepth<depth) maxDepth=depth;
+    STATS(stats.Expanded(depth));
+    // test all possible movements from here...
+    StateIndex succ[MAX_SUCCESSORS];
+    int        count = GetSuccessors(index,succ);
+    for (int i=0;i<count && last<0;i++) {
+      if (succ[i]==SUCCESSOR_ILLEGAL) {
+        // dead end, but the other movements may still lead somewhere
+        STATS(stats.illegalHits++);
+        continue;
+      }
+      else if (succ[i]==SUCCESSOR_GOAL) {
+        STATS(stats.goalHits++);
+        last = index;
+      }
+      else if (Visited(succ[i])==0) {
+        SetVisited(succ[i],depth+1);
+        SetParent(succ[i],(StateIndex)index);
+        queue.push_back(succ[i]);
+        STATS(stats.Level(depth+1,1));
+      }
+      else {
+        STATS(stats.duplicates++);
+      }
+    }
+  }
+  return last;
+}
+
+// ---------------------------------------------------------------------------------
+// Traverse the state space breadth-first, level by level, on 'threads' threads
+// ---------------------------------------------------------------------------------
+// The states of the current level (the frontier) are split among the threads.
+// A thread claims a successor by atomically setting its bit in the 'claimed'
+// bitmap; only the thread that actually flipped the bit writes the 'visited'
+// and 'parent' columns of that state and appends it to its own buffer for the
+// next level. Which thread claims a state first depends on thread timing, so
+// a second pass over the level then settles the parent of every state of the
+// next level to its predecessor with the smallest index (an atomic minimum).
+// When all threads are done with the level, their buffers are concatenated
+// into the next frontier, a vector that grows with the levels (as the queue of
+// BfsTraverse() does), so that only 'claimed' takes memory for every state
+// (a bit each). Returns, as BfsTraverse() does, a state of minimal
+// depth that has a goal state as successor (the one with the smallest index
+// among those of that depth) or -1 if the goal cannot be reached. The result
+// and the parents, and so the path printed, do not depend on thread timing or
+// the number of threads (they may differ from those of BfsTraverse(), which
+// takes the first predecessor in its queue).
+// ---------------------------------------------------------------------------------
+
+long Searcher::ParallelBfsTraverse(long startIndex,int &maxDepth) {
+  typedef std::atomic<unsigned long> Word;
+  const int  WORD_BITS = 8*(int)sizeof(unsigned long);
+  long       words     = (TotalStates()+WORD_BITS-1)/WORD_BITS;
+  Word      *claimed   = new Word[words];
+  for (long i=0;i<words;i++) claimed[i].store(0,std::memory_order_relaxed);
+
+  std::vector<StateIndex>  frontier;
+  std::vector<StateIndex> *nextBuffers = new std::vector<StateIndex>[threads];
+  long       *goalFound    = new long[threads];
+  long        last         = -1;
+  // per thread: duplicates, goal hits, illegal hits
+  STATS(long *hits = new long[3*threads]);
+
+  claimed[startIndex/WORD_BITS] |= 1UL << (startIndex%WORD_BITS);
+  SetVisited(startIndex,1);
+  SetParent(startIndex,-1);
+  frontier.push_back((StateIndex)startIndex);
+  STATS(stats.Level(1,1));
+  for (int depth=1;!frontier.empty() && last<0;depth++) {
+    long frontierSize = (long)frontier.size();
+    if (maxDepth<depth) maxDepth=depth;
+    STATS(for (long f=0;f<frontierSize;f++) stats.Expanded(depth));
+    // expand the current level (not every thread gets work on small levels)
+    for (int t=0;t<threads;t++) {
+      nextBuffers[t].clear();
+      goalFound[t] = -1;
+      STATS(hits[3*t] = hits[3*t+1] = hits[3*t+2] = 0);
+    }
+    ParallelFor(0,frontierSize,threads,[&](long from,long to,int t) {
+      std::vector<StateIndex> &next = nextBuffers[t];
+      for (long f=from;f<to;f++) {
+        long       index = frontier[f];
+        StateIndex succ[MAX_SUCCESSORS];
+        int        count = GetSuccessors(index,succ);
+        for (int i=0;i<count;i++) {
+          if (succ[i]==SUCCESSOR_ILLEGAL) {
+            // dead end, but the other movements may still lead somewhere
+            STATS(hits[3*t+2]++);
+            continue;
+          }
+          else if (succ[i]==SUCCESSOR_GOAL) {
+            STATS(hits[3*t+1]++);
+            if (goalFound[t]<0 || index<goalFound[t]) goalFound[t] = index;
+          }
+          else {
+            unsigned long bit = 1UL << (succ[i]%WORD_BITS);
+            if ((claimed[succ[i]/WORD_BITS].fetch_or(bit) & bit)==0) {
+              visited[succ[i]] = visitedBase+depth+1;
+              parent[succ[i]]  = (StateIndex)index;
+              next.push_back(succ[i]);
+            }
+            else {
+              STATS(hits[3*t]++);
+            }
+          }
+        }
+      }
+    });
+    // settle the parents of the next level, unless the search ends here
+    BOOL goal = FALSE;
+    for (int t=0;t<threads;t++) goal = goal || goalFound[t]>=0;
+    if (!goal) {
+      ParallelFor(0,frontierSize,threads,[&](long from,long to,int) {
+        for (long f=from;f<to;f++) {
+          StateIndex index = frontier[f];
+          StateIndex succ[MAX_SUCCESSORS];
+          int        count = GetSuccessors(index,succ);
+          for (int i=0;i<count;i++) {
+            if (succ[i]<0 || visited[succ[i]]!=visitedBase+depth+1) continue;
+            StateIndex *p    = &parent[succ[i]];
+            StateIndex  seen = __atomic_load_n(p,__ATOMIC_RELAXED);
+            while (index<seen &&
+                   !__atomic_compare_exchange_n(p,&seen,index,TRUE,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) {
+            }
+          }
+        }
+      });
+    }
+    // merge the per-thread buffers into the next frontier
+    if (visitedTop<visitedBase+depth+1) visitedTop = visitedBase+depth+1;
+    frontier.clear();
+    for (int t=0;t<threads;t++) {
+      STATS(stats.duplicates += hits[3*t]);
+      STATS(stats.goalHits += hits[3*t+1]);
+      STATS(stats.illegalHits += hits[3*t+2]);
+      if (goalFound[t]>=0 && (last<0 || goalFound[t]<last)) last = goalFound[t];
+      frontier.insert(frontier.end(),nextBuffers[t].begin(),nextBuffers[t].end());
+    }
+    STATS(if (!frontier.empty()) stats.Level(depth+1,(long)frontier.size()));
+  }
+  delete[] claimed;
+  delete[] nextBuffers;
+  delete[] goalFound;
+  STATS(delete[] hits);
+  return last;
+}
+
+// ---------------------------------------------------------------------------------
+// Determine for every start position whether and in how many moves the goal can
+// be reached
+// ---------------------------------------------------------------------------------
+// Rather than searching forward from every one of the start positions, this
+// runs a single breadth-first search backwards over the reverse successor
+// graph, starting from all states that have a goal state as successor (these
+// are 1 move away from the goal). This gives the distance to the goal of every
+// state at once. Then the distances of the start positions (no pencil moved
+// yet, every pencil at any box, every rule flag inactive or active) are printed
+// as tables with pencil 0 in the rows and pencil 1 in the columns, one table
+// per combination of the flags and of the boxes of the further pencils (with
+// more than two pencils); '-' means the goal cannot be reached. With more
+// pencils or flags than those of the puzzle, the solvable start positions of
+// all the tables are counted at the end.
+// ---------------------------------------------------------------------------------
+
+void Searcher::StartAllPairsSweep(void) {
+  STATS(StatsTimer timer(stats.searchSeconds));
+  BuildReverseGraph();
+  long        total    = TotalStates();
+  int        *distance = new int[total];
+  StateIndex *queue    = new StateIndex[total];
+  long        head     = 0;
+  long        tail     = 0;
+  memset(distance,0,total*sizeof(int));
+  for (long i=0;i<preGoalCount;i++) {
+    distance[preGoal[i]] = 1;
+    queue[tail++]        = preGoal[i];
+  }
+  while (head<tail) {
+    long              index = queue[head++];
+    const StateIndex *first;
+    int               count = reverse->Successors(index,first);
+    for (int i=0;i<count;i++) {
+      if (distance[first[i]]==0) {
+        distance[first[i]] = distance[index]+1;
+        queue[tail++]      = first[i];
+      }
+    }
+  }
+  std::cerr << tail << " states can reach the goal" << std::endl << std::flush;
+  const Maze &maze      = Maze::Current();
+  int         boxes     = maze.BoxCount();
+  int         further[MAX_PENCILS] = { 0 }; // box indexes of pencils 2 and up
+  long        tables    = 0;
+  long        solvable  = 0;
+  for (int flags=0;flags<(1<<maze.FlagCount());flags++) {
+    BOOL more = TRUE;
+    for (int p=2;p<maze.PencilCount();p++) further[p] = 0;
+    while (more) {
+      State base = StartState();
+      std::cout << "---- Moves to the goal, rule 60 " << ((flags & 1) ? "active" : "inactive");
+      for (int f=0;f<maze.FlagCount();f++) {
+        base.SetFlag(f,(flags>>f & 1)!=0);
+        if (f>0) std::cout << ", flag " << f << " " << ((flags>>f & 1) ? "active" : "inactive");
+      }
+      for (int p=2;p<maze.PencilCount();p++) {
+        base.SetPencil(p,maze.Number(further[p]));
+        std::cout << ", pencil " << p << " at " << maze.Number(further[p]);
+      }
+      std::cout << std::endl;
+      std::cout << "   ";
+      for (int p1=0;p1<boxes;p1++) {
+        std::cout.width(4);
+        std::cout << maze.Number(p1);
+      }
+      std::cout << std::endl;
+      long found = 0;
+      for (int p0=0;p0<boxes;p0++) {
+        std::cout.width(3);
+        std::cout << maze.Number(p0);
+        for (int p1=0;p1<boxes;p1++) {
+          State start = base;
+          start.SetPencil(0,maze.Number(p0));
+          start.SetPencil(1,maze.Number(p1));
+          int d = distance[CanonicalIndex(start)];
+          std::cout.width(4);
+          if (d>0) {
+            std::cout << d;
+            found++;
+          }
+          else {
+            std::cout << "-";
+          }
+        }
+        std::cout << std::endl;
+      }
+      std::cout << found << " of " << boxes*boxes
+                << " start positions are solvable" << std::endl << std::flush;
+      tables++;
+      solvable += found;
+      // the next boxes of the further pencils, the last pencil counting fastest
+      more = FALSE;
+      for (int p=maze.PencilCount()-1;p>=2 && !more;p--) {
+        further[p] = (further[p]+1) % boxes;
+        more       = further[p]!=0;
+      }
+    }
+  }
+  if (maze.PencilCount()>2 || maze.FlagCount()>1) {
+    std::cout << solvable << " of " << tables*boxes*boxes
+              << " start positions are solvable in all" << std::endl << std::flush;
+  }
+  delete[] distance;
+  delete[] queue;
+}
+
+// ---------------------------------------------------------------------------------
+// Solve the maze with the breadth-first search of "LeanSearch", with visited set
+// 'visitedMode' (VISITED_...), spilling the levels of VISITED_DISK into a new
+// directory in 'spillDirectory'. Returns FALSE if that directory or a level file
+// in it cannot be created, written or read (the message names it).
+// ---------------------------------------------------------------------------------
+
+BOOL Searcher::StartLeanSearch(int visitedMode,const char *spillDirectory) {
+  STATS(StatsTimer timer(stats.searchSeconds));
+  LeanSearch search(*this,visitedMode,spillDirectory);
+  SetOrigin(StartState());
+  int length = search.Run(CanonicalIndex(origin));
+  if (length<0) return FALSE;
+  std::cout << search.Reached() << " states visited, at most " << search.Widest() << " on a level";
+  if (search.Mode()==VISITED_DISK) std::cout << ", " << search.Spilled() << " bytes of runs spilled";
+  std::cout << std::endl;
+  if (length==0) {
+    std::cout << "Goal state cannot be reached!" << std::endl << std::flush;
+    return TRUE;
+  }
+  std::cerr << "Goal state encountered at " << length << "!" << std::endl << std::flush;
+  if (search.Path()!=NULL) {
+    PrintPath(search.Path(),length,"Shortest path",std::cout);
+  }
+  else {
+    State s = State::FromIndex(search.Last());
+    ConcretePath(&s,1);
+    std::cout << "---- Last state of a shortest path, depth " << length << "\n" << s << std::endl << std::flush;
+  }
+  return TRUE;
+}
+
+// ---------------------------------------------------------------------------------
+// Condense the state graph (see "Condensation"), list the loop traps the
+// pencils can get into from the start state, and count the solvable start
+// positions from the condensed graph.
+// ---------------------------------------------------------------------------------
+
+void Searcher::StartCondensation(void) {
+  Reset();
+  SetOrigin(StartState());
+  Condensation scc(*this);
+  long  start   = CanonicalIndex(origin);
+  char *reached = new char[scc.Components()];
+  long  loops   = 0;
+  long  traps   = 0;
+  for (long c=0;c<scc.Components();c++) {
+    if (scc.LoopP(c)) loops++;
+  }
+  std::cerr << scc.Components() << " strongly connected components, " << loops
+            << " of them loops" << std::endl << std::flush;
+  scc.Reachable(start,reached);
+  for (long c=scc.Components()-1;c>=0;c--) {
+    if (!reached[c] || !scc.LoopP(c)) continue;
+    const StateIndex *first;
+    int count = scc.Members(c,first);
+    std::cout << "---- Loop trap " << ++traps << ", " << count << " states, "
+              << (scc.ReachesGoalP(first[0]) ? "the goal can be reached" : "the goal cannot be reached")
+              << std::endl;
+    for (int i=0;i<count && i<SCC_LIST_LIMIT;i++) {
+      std::cout << State::FromIndex(first[i]) << std::endl;
+    }
+    if (count>SCC_LIST_LIMIT) std::cout << "..." << std::endl;
+  }
+  std::cout << traps << " loop traps can be reached from the start state" << std::endl;
+  const Maze &maze = Maze::Current();
+  for (int rule60=0;rule60<2;rule60++) {
+    int solvable = 0;
+    for (int p0=0;p0<maze.BoxCount();p0++) {
+      for (int p1=0;p1<maze.BoxCount();p1++) {
+        State s = StartState();
+        s.SetPencil(0,maze.Number(p0));
+        s.SetPencil(1,maze.Number(p1));
+        s.SetRule60(rule60);
+        if (scc.ReachesGoalP(CanonicalIndex(s))) solvable++;
+      }
+    }
+    std::cout << solvable << " of " << maze.BoxCount()*maze.BoxCount() << " start positions are solvable, rule 60 "
+              << (rule60 ? "active" : "inactive") << std::endl;
+  }
+  std::cout << std::flush;
+  delete[] reached;
+}
+
+// ---------------------------------------------------------------------------------
+// Search from the start state forward and from the goal backward at the same
+// time
+// ---------------------------------------------------------------------------------
+// The forward search is a breadth-first search from the start state, using the
+// 'visited' and 'parent' columns as BfsTraverse() does. The backward search is
+// a breadth-first search over the reverse successor graph, starting from all
+// states that have a goal state as successor; for every state it reaches it
+// records the number of moves to the goal and the next state on the way to the
+// goal (-1 for a state that has a goal state as successor), in a hash map
+// ('backwardReached'). The queues of both sides are vectors, so a query takes
+// time and memory for the states it reaches only (as 'visited' needs no
+// clearing, see Reset()); the reverse graph is built once. At every step the side with the smaller frontier is expanded by
+// one level. Whenever one side reaches a state already reached by the other
+// side, the solution length through that state is a candidate. Once the best
+// candidate is no longer than any solution that could still be found (the sum
+// of the depths of both frontiers plus one move), the search stops.
+//
+// Solution lengths are counted in moves, which is also the number of states on
+// the path to the goal (including the start state, excluding the goal state).
+// BidirectionalTraverse() sets 'path' to these states and returns their number,
+// or 0 if the goal cannot be reached.
+// ---------------------------------------------------------------------------------
+
+void Searcher::StartBidirectionalTraversal(void) {
+  STATS(StatsTimer timer(stats.searchSeconds));
+  Reset();
+  SetOrigin(StartState());
+  std::vector<StateIndex> path;
+  int                     length = BidirectionalTraverse(CanonicalIndex(origin),path);
+  if (length==0) {
+    std::cerr << "Goal state cannot be reached!" << std::endl << std::flush;
+  }
+  else {
+    std::cerr << "Goal state encountered at " << length << "!" << std::endl << std::flush;
+    PrintPath(path.data(),length,"Shortest path",std::cout);
+  }
+}
+
+int Searcher::BidirectionalTraverse(long startIndex,std::vector<StateIndex> &path) {
+  // a state reached backward: its moves to the goal and the next state on the way
+  struct BackwardStep {
+    int        toGoal;
+    StateIndex child;
+  };
+  typedef std::unordered_map<StateIndex,BackwardStep> BackwardMap;
+  BuildReverseGraph();
+  BackwardMap             backwardReached;
+  std::vector<StateIndex> forward;     // forward queue
+  std::vector<StateIndex> backward;    // backward queue
+  size_t                  forwardHead   = 0;
+  size_t                  backwardHead  = 0;
+  int                     forwardMoves  = 0;  // moves from the start to the forward frontier
+  int                     backwardMoves = 1;  // moves from the backward frontier to the goal
+  int                     best          = 0;  // length of the best solution found (0: none)
+  long                    meet          = -1; // the state where that solution's halves meet
+  // the moves to the goal of a state reached backward, 0 for any other
+  auto toGoal = [&backwardReached](StateIndex index) {
+    BackwardMap::const_iterator step = backwardReached.find(index);
+    return (step==backwardReached.end()) ? 0 : step->second.toGoal;
+  };
+  backwardReached.reserve(2*preGoalCount);
+  for (long i=0;i<preGoalCount;i++) {
+    BackwardStep step = { 1,-1 };
+    backwardReached[preGoal[i]] = step;
+    backward.push_back(preGoal[i]);
+  }
+  SetVisited(startIndex,1);
+  SetParent(startIndex,-1);
+  forward.push_back((StateIndex)startIndex);
+  if (toGoal((StateIndex)startIndex)>0) {
+    best = toGoal((StateIndex)startIndex);
+    meet = startIndex;
+  }
+  while (forwardHead<forward.size() && backwardHead<backward.size() &&
+         (best==0 || best>forwardMoves+backwardMoves+1)) {
+    if (forward.size()-forwardHead<=backward.size()-backwardHead) {
+      // expand one level forward
+      size_t levelEnd = forward.size();
+      while (forwardHead<levelEnd) {
+        long       index = forward[forwardHead++];
+        StateIndex succ[MAX_SUCCESSORS];
+        int        count = GetSuccessors(index,succ);
+        for (int i=0;i<count;i++) {
+          if (succ[i]<0 || Visited(succ[i])>0) continue;
+          SetVisited(succ[i],Visited(index)+1);
+          SetParent(succ[i],(StateIndex)index);
+          forward.push_back(succ[i]);
+          int moves = toGoal(succ[i]);
+          if (moves>0 && (best==0 || forwardMoves+1+moves<best)) {
+            best = forwardMoves+1+moves;
+            meet = succ[i];
+          }
+        }
+      }
+      forwardMoves++;
+    }
+    else {
+      // expand one level backward
+      size_t levelEnd = backward.size();
+      while (backwardHead<levelEnd) {
+        long              index = backward[backwardHead++];
+        const StateIndex *first;
+        int               count = reverse->Successors(index,first);
+        for (int i=0;i<count;i++) {
+          BackwardStep step = { backwardMoves+1,(StateIndex)index };
+          if (!backwardReached.insert(std::make_pair(first[i],step)).second) continue;
+          backward.push_back(first[i]);
+          if (Visited(first[i])>0 && (best==0 || Visited(first[i])-1+backwardMoves+1<best)) {
+            best = Visited(first[i])-1+backwardMoves+1;
+            meet = first[i];
+          }
+        }
+      }
+      backwardMoves++;
+    }
+  }
+  std::cerr << "Bidirectional search reached " << forward.size() << " states forward and "
+            << backward.size() << " states backward" << std::endl << std::flush;
+  path.clear();
+  if (best>0) {
+    // the forward half from the parent pointers, the backward half from the
+    // child pointers
+    int  forwardLength = Visited(meet);
+    long index         = meet;
+    path.resize(forwardLength);
+    for (int i=forwardLength-1;i>=0;i--) {
+      path[i] = (StateIndex)index;
+      index   = Parent(index);
+    }
+    for (index=backwardReached[(StateIndex)meet].child;index>=0;index=backwardReached[(StateIndex)index].child) {
+      path.push_back((StateIndex)index);
+    }
+    assert((int)path.size()==best);
+  }
+  return (int)path.size();
+}
+
+// ---------------------------------------------------------------------------------
+// A* search toward the goal (see "Searcher")
+// ---------------------------------------------------------------------------------
+
+void Searcher::StartAStarTraversal(void) {
+  STATS(StatsTimer timer(stats.searchSeconds));
+  Reset();
+  SetOrigin(StartState());
+  long expanded = 0;
+  long last     = AStarTraverse(CanonicalIndex(origin),expanded);
+  if (last<0) {
+    std::cerr << "Goal state cannot be reached!" << std::endl << std::flush;
+  }
+  else {
+    std::cerr << "Goal state encountered at " << Visited(last) << "!" << std::endl << std::flush;
+    DumpPath(last,"Shortest path",std::cout);
+  }
+  std::cout << "A* expanded " << expanded << " states" << std::endl << std::flush;
+}
+
+// ---------------------------------------------------------------------------------
+// The moves every box is away from a box with an exit to the goal, by a
+// breadth-first search backward over the exits of the boxes
+// ---------------------------------------------------------------------------------
+
+void Searcher::BoxDistances(void) {
+  if (boxDistance!=NULL) return;
+  const Maze      &maze  = Maze::Current();
+  int              boxes = maze.BoxCount();
+  std::vector<int> offsets(boxes+1,0);
+  std::vector<int> from;
+  std::vector<int> queue;
+  boxDistance = new int[boxes];
+  for (int i=0;i<boxes;i++) {
+    const BoxRule &rule = maze.Rule(i);
+    boxDistance[i] = INT_MAX;
+    if (rule.yes==GOAL_MAZEPOINT || rule.no==GOAL_MAZEPOINT) {
+      boxDistance[i] = 0;
+      queue.push_back(i);
+    }
+    if (rule.yes!=GOAL_MAZEPOINT) offsets[maze.Index(rule.yes)+1]++;
+    if (rule.no!=GOAL_MAZEPOINT)  offsets[maze.Index(rule.no)+1]++;
+  }
+  for (int i=0;i<boxes;i++) offsets[i+1] += offsets[i];
+  from.resize(offsets[boxes]);
+  std::vector<int> cursor(offsets.begin(),offsets.end()-1);
+  for (int i=0;i<boxes;i++) {
+    const BoxRule &rule = maze.Rule(i);
+    if (rule.yes!=GOAL_MAZEPOINT) from[cursor[maze.Index(rule.yes)]++] = i;
+    if (rule.no!=GOAL_MAZEPOINT)  from[cursor[maze.Index(rule.no)]++]  = i;
+  }
+  for (size_t head=0;head<queue.size();head++) {
+    int box = queue[head];
+    for (int k=offsets[box];k<offsets[box+1];k++) {
+      if (boxDistance[from[k]]!=INT_MAX) continue;
+      boxDistance[from[k]] = boxDistance[box]+1;
+      queue.push_back(from[k]);
+    }
+  }
+}
+
+inline int Searcher::Heuristic(long index) const {
+  State s      = State::FromIndex(index);
+  int   result = INT_MAX;
+  for (int p=0;p<State::Pencils();p++) {
+    if (boxDistance[s.BoxIndex(p)]<result) result = boxDistance[s.BoxIndex(p)];
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------------
+// The queue holds a list of states per value of f (depth plus heuristic), the
+// lowest f taken first, and within a list the state added last. A state whose
+// recorded depth got smaller after it was added is skipped when taken. States
+// from which no box with a goal exit can be reached are never added. Returns
+// the last state of a shortest solution (-1 if there is none) and counts the
+// states expanded in 'expanded'.
+// ---------------------------------------------------------------------------------
+
+long Searcher::AStarTraverse(long startIndex,long &expanded) {
+  typedef std::pair<StateIndex,int> Entry; // state, depth
+  std::vector<std::vector<Entry> > open;
+  StateIndex                       succ[MAX_SUCCESSORS];
+  BoxDistances();
+  expanded = 0;
+  if (Heuristic(startIndex)==INT_MAX) return -1;
+  SetVisited(startIndex,1);
+  SetParent(startIndex,-1);
+  open.resize(1+Heuristic(startIndex)+1);
+  open[1+Heuristic(startIndex)].push_back(Entry((StateIndex)startIndex,1));
+  for (size_t f=0;f<open.size();f++) {
+    while (!open[f].empty()) {
+      Entry entry = open[f].back();
+      open[f].pop_back();
+      long index = entry.first;
+      int  depth = entry.second;
+      if (Visited(index)<depth) continue;
+      expanded++;
+      STATS(stats.Expanded(depth));
+      int count = GetSuccessors(index,succ);
+      for (int i=0;i<count;i++) {
+        if (succ[i]==SUCCESSOR_GOAL) {
+          STATS(stats.goalHits++);
+          return index;
+        }
+        if (succ[i]<0) {
+          STATS(stats.illegalHits++);
+          continue;
+        }
+        int h = Heuristic(succ[i]);
+        if (h==INT_MAX || (Visited(succ[i])>0 && Visited(succ[i])<=depth+1)) {
+          STATS(stats.duplicates++);
+          continue;
+        }
+        SetVisited(succ[i],depth+1);
+        SetParent(succ[i],(StateIndex)index);
+        size_t g = (size_t)(depth+1+h);
+        if (open.size()<=g) open.resize(g+1);
+        open[g].push_back(Entry(succ[i],depth+1));
+      }
+    }
+  }
+  return -1;
+}
+
+// =================================================================================
+// Definitions for "ShortestSolutions"
+// =================================================================================
+
+ShortestSolutions::ShortestSolutions(Searcher &searcherIn,long startIndexIn)
+  : searcher(searcherIn) {
+  long total     = Searcher::TotalStates();
+  startIndex     = startIndexIn;
+  length         = 0;
+  count          = 0;
+  saturated      = FALSE;
+  pathCount      = new unsigned long[total];
+  onPath         = new char[total];
+  started        = FALSE;
+  path           = NULL;
+  candidates     = NULL;
+  candidateCount = NULL;
+  cursor         = NULL;
+  memset(onPath,0,total);
+
+  // breadth-first search with path counting, up to the end of the goal level;
+  // the queue holds the states level by level, as the pass back needs them
+  StateIndex *queue = new StateIndex[total];
+  long        head  = 0;
+  long        tail  = 0;
+  searcher.SetVisited(startIndex,1);
+  searcher.SetParent(startIndex,-1);
+  pathCount[startIndex] = 1;
+  queue[tail++]         = (StateIndex)startIndex;
+  while (head<tail) {
+    long index = queue[head];
+    int  depth = searcher.Visited(index);
+    if (length>0 && depth>length) break;
+    head++;
+    StateIndex succ[MAX_SUCCESSORS];
+    BOOL       goal;
+    int        n = LevelSuccessors(index,succ,goal);
+    if (goal) {
+      length = depth;
+      if (count+pathCount[index]<count) saturated = TRUE;
+      count = saturated ? ULONG_MAX : count+pathCount[index];
+      onPath[index] = 1;
+    }
+    if (length>0) continue;
+    for (int i=0;i<n;i++) {
+      int succDepth = searcher.Visited(succ[i]);
+      if (succDepth==0) {
+        searcher.SetVisited(succ[i],depth+1);
+        searcher.SetParent(succ[i],(StateIndex)index);
+        pathCount[succ[i]] = pathCount[index];
+        queue[tail++]      = succ[i];
+      }
+      else if (succDepth==depth+1) {
+        unsigned long sum = pathCount[succ[i]]+pathCount[index];
+        pathCount[succ[i]] = (sum<pathCount[index]) ? ULONG_MAX : sum;
+      }
+    }
+  }
+
+  // back over the levels above the goal level: a state is on a shortest
+  // solution if one of its successors of the next depth is
+  for (long q=head-1;q>=0 && length>0;q--) {
+    long index = queue[q];
+    int  depth = searcher.Visited(index);
+    if (depth==length) continue;
+    StateIndex succ[MAX_SUCCESSORS];
+    BOOL       goal;
+    int        n = LevelSuccessors(index,succ,goal);
+    for (int i=0;i<n && !onPath[index];i++) {
+      if (searcher.Visited(succ[i])==depth+1 && onPath[succ[i]]) onPath[index] = 1;
+    }
+  }
+  delete[] queue;
+
+  if (length>0) {
+    path           = new StateIndex[length];
+    candidates     = new StateIndex[length*MAX_SUCCESSORS];
+    candidateCount = new int[length];
+    cursor         = new int[length];
+  }
+}
+
+ShortestSolutions::~ShortestSolutions(void) {
+  delete[] pathCount;
+  delete[] onPath;
+  delete[] path;
+  delete[] candidates;
+  delete[] candidateCount;
+  delete[] cursor;
+}
+
+// ---------------------------------------------------------------------------------
+// The distinct legal successors of state 'index' that are not goal states;
+// 'goal' tells whether one of the successors is a goal state
+// ---------------------------------------------------------------------------------
+
+int ShortestSolutions::LevelSuccessors(long index,StateIndex *succ,BOOL &goal) {
+  StateIndex all[MAX_SUCCESSORS];
+  int        count = searcher.GetSuccessors(index,all);
+  int        n     = 0;
+  goal = FALSE;
+  for (int i=0;i<count;i++) {
+    if (all[i]==SUCCESSOR_GOAL) {
+      goal = TRUE;
+    }
+    else if (all[i]!=SUCCESSOR_ILLEGAL) {
+      int j = 0;
+      while (j<n && succ[j]!=all[i]) j++;
+      if (j==n) succ[n++] = all[i];
+    }
+  }
+  return n;
+}
+
+// ---------------------------------------------------------------------------------
+// Complete the path from 'level' on with the first marked successor at every
+// level; a marked state above the goal level always has one
+// ---------------------------------------------------------------------------------
+
+void ShortestSolutions::Descend(int level) {
+  for (int i=level;i<length-1;i++) {
+    StateIndex  succ[MAX_SUCCESSORS];
+    StateIndex *cand = candidates+i*MAX_SUCCESSORS;
+    BOOL        goal;
+    int         n = LevelSuccessors(path[i],succ,goal);
+    candidateCount[i] = 0;
+    for (int j=0;j<n;j++) {
+      if (searcher.Visited(succ[j])==i+2 && onPath[succ[j]]) {
+        cand[candidateCount[i]++] = succ[j];
+      }
+    }
+    assert(candidateCount[i]>0);
+    cursor[i]  = 0;
+    path[i+1]  = cand[0];
+  }
+}
+
+BOOL ShortestSolutions::Next(StateIndex *solution) {
+  if (length==0) return FALSE;
+  if (!started) {
+    started = TRUE;
+    path[0] = (StateIndex)startIndex;
+    Descend(0);
+  }
+  else {
+    // advance the deepest level that has another candidate left
+    int level = length-2;
+    while (level>=0 && cursor[level]+1>=candidateCount[level]) level--;
+    if (level<0) return FALSE;
+    cursor[level]++;
+    path[level+1] = candidates[level*MAX_SUCCESSORS+cursor[level]];
+    Descend(level+1);
+  }
+  memcpy(solution,path,length*sizeof(StateIndex));
+  return TRUE;
+}
+
+// =================================================================================
+// Definitions for "LeanSearch"
+// =================================================================================
+
+const char *VISITED_NAME[4] = { "auto","bits","layers","disk" };
+
+LeanSearch::LeanSearch(Searcher &searcherIn,int modeIn,const char *spillDirectory) : searcher(searcherIn) {
+  mode    = modeIn;
+  last    = -1;
+  reached = 0;
+  widest  = 0;
+  spilled = 0;
+  path    = NULL;
+  if (mode==VISITED_AUTO) {
+    long available = AvailableBytes();
+    mode = VISITED_DISK;
+    for (int m=VISITED_LAYERS;m>=VISITED_BITS;m--) {
+      if (ModeBytes(m)<=available) mode = m;
+    }
+  }
+  if (mode==VISITED_DISK) {
+    std::string name = std::string(spillDirectory)+"/cows-XXXXXX";
+    std::vector<char> buffer(name.begin(),name.end());
+    buffer.push_back('\0');
+    if (mkdtemp(&buffer[0])==NULL) {
+      // Run() fails, 'directory' being empty
+      std::cerr << name << ": Cannot create a directory for the levels" << std::endl << std::flush;
+    }
+    else {
+      directory = &buffer[0];
+    }
+  }
+}
+
+LeanSearch::~LeanSearch(void) {
+  for (size_t i=0;i<files.size();i++) unlink(files[i].c_str());
+  if (!directory.empty()) rmdir(directory.c_str());
+  delete[] path;
+}
+
+// ---------------------------------------------------------------------------------
+// The memory a mode needs for the state space of the installed maze (the lists
+// of VISITED_BITS estimated with LEAN_FRONTIER_SHARE), and the memory available
+// ---------------------------------------------------------------------------------
+
+long LeanSearch::ModeBytes(int mode) {
+  long total = Searcher::TotalStates();
+  switch (mode) {
+  case VISITED_BITS:
+    return total/8+2*(total/LEAN_FRONTIER_SHARE)*(long)sizeof(StateIndex);
+  case VISITED_LAYERS:
+    return total/4;
+  default:
+    return 2*DISK_BUFFER*(long)sizeof(StateIndex);
+  }
+}
+
+long LeanSearch::AvailableBytes(void) {
+  long          bytes = sysconf(_SC_AVPHYS_PAGES)*sysconf(_SC_PAGESIZE);
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_AS,&limit)==0 && limit.rlim_cur!=RLIM_INFINITY && (rlim_t)bytes>limit.rlim_cur) {
+    bytes = (long)limit.rlim_cur;
+  }
+  return bytes;
+}
+
+int LeanSearch::Run(long startIndex) {
+  std::cerr << "Visited set: " << VISITED_NAME[mode] << ", " << ModeBytes(mode) << " bytes of memory" << std::endl << std::flush;
+  if (mode==VISITED_DISK && directory.empty()) return -1;
+  switch (mode) {
+  case VISITED_BITS:   return BitsSearch(startIndex);
+  case VISITED_LAYERS: return LayersSearch(startIndex);
+  default:             return DiskSearch(startIndex);
+  }
+}
+
+int LeanSearch::BitsSearch(long startIndex) {
+  long                     total = Searcher::TotalStates();
+  std::vector<unsigned long long> seen((total+63)/64,0);
+  std::vector<StateIndex>  current;
+  std::vector<StateIndex>  next;
+  StateIndex               succ[MAX_SUCCESSORS];
+  seen[startIndex>>6] |= 1ULL<<(startIndex&63);
+  current.push_back((StateIndex)startIndex);
+  reached = 1;
+  for (int depth=1;!current.empty();depth++) {
+    if (widest<(long)current.size()) widest = (long)current.size();
+    for (size_t i=0;i<current.size();i++) {
+      int count = searcher.FreshSuccessors(current[i],succ);
+      for (int k=0;k<count;k++) {
+        if (succ[k]==SUCCESSOR_GOAL) {
+          last = current[i];
+          return depth;
+        }
+        if (succ[k]<0 || (seen[succ[k]>>6]>>(succ[k]&63) & 1)) continue;
+        seen[succ[k]>>6] |= 1ULL<<(succ[k]&63);
+        next.push_back(succ[k]);
+      }
+    }
+    reached += (long)next.size();
+    current.swap(next);
+    next.clear();
+  }
+  return 0;
+}
+
+// the codes of VISITED_LAYERS, four to a byte; the codes of the current and the
+// next level are LAYER_A and LAYER_B, in turn
+const int LAYER_UNSEEN = 0;
+const int LAYER_A      = 1;
+const int LAYER_B      = 2;
+const int LAYER_CLOSED = 3;
+
+static inline int LayerCode(const unsigned char *codes,long index) {
+  return (codes[index>>2]>>(2*(index&3))) & 3;
+}
+
+static inline void SetLayerCode(unsigned char *codes,long index,int code) {
+  unsigned char &byte = codes[index>>2];
+  byte = (unsigned char)((byte & ~(3<<(2*(index&3)))) | (code<<(2*(index&3))));
+}
+
+int LeanSearch::LayersSearch(long startIndex) {
+  long                       total = Searcher::TotalStates();
+  std::vector<unsigned char> codes((total+3)/4,0);
+  StateIndex                 succ[MAX_SUCCESSORS];
+  int                        current = LAYER_A;
+  long                       count   = 1;
+  SetLayerCode(&codes[0],startIndex,current);
+  reached = 1;
+  for (int depth=1;count>0;depth++) {
+    int next = LAYER_A+LAYER_B-current;
+    if (widest<count) widest = count;
+    count = 0;
+    for (long index=0;index<total;index++) {
+      // skip the bytes without a state of the current level quickly
+      if ((index&3)==0 && (codes[index>>2]==0 || codes[index>>2]==0xFF)) {
+        index += 3;
+        continue;
+      }
+      if (LayerCode(&codes[0],index)!=current) continue;
+      int n = searcher.FreshSuccessors(index,succ);
+      for (int k=0;k<n;k++) {
+        if (succ[k]==SUCCESSOR_GOAL) {
+          last = index;
+          return depth;
+        }
+        if (succ[k]<0 || LayerCode(&codes[0],succ[k])!=LAYER_UNSEEN) continue;
+        SetLayerCode(&codes[0],succ[k],next);
+        count++;
+      }
+      SetLayerCode(&codes[0],index,LAYER_CLOSED);
+    }
+    reached += count;
+    current  = next;
+  }
+  return 0;
+}
+
+// ---------------------------------------------------------------------------------
+// Files of VISITED_DISK: binary state indexes, read and written through a
+// buffer of their own
+// ---------------------------------------------------------------------------------
+
+const int SPILL_BLOCK = 1 << 14;
+
+// A file that cannot be opened, read or written, or that ends in the middle of
+// a state index, writes a message naming it once and clears 'ok'; after that,
+// Next() returns FALSE and Put() does nothing. Close() writes out the rest of a
+// written file and tells whether all of it went well.
+
+class SpillReader {
+  FILE                   *file;
+  std::vector<StateIndex> block;
+  size_t                  at;
+  size_t                  size;
+  std::string             name;
+  void Fail(const char *what) {
+    if (ok) std::cerr << name << ": " << what << std::endl << std::flush;
+    ok = FALSE;
+  }
+public:
+  StateIndex value;
+  BOOL       ok;
+  SpillReader(const std::string &nameIn) : block(SPILL_BLOCK),at(0),size(0),name(nameIn),value(-1),ok(TRUE) {
+    file = fopen(name.c_str(),"rb");
+    if (file==NULL) Fail("Cannot be read");
+  }
+  ~SpillReader(void) { if (file!=NULL) fclose(file); }
+  BOOL Next(void) {
+    if (!ok) return FALSE;
+    if (at==size) {
+      size_t bytes = fread(&block[0],1,SPILL_BLOCK*sizeof(StateIndex),file);
+      if (ferror(file)) {
+        Fail("Cannot be read");
+        return FALSE;
+      }
+      if (bytes%sizeof(StateIndex)!=0) {
+        Fail("Is truncated");
+        return FALSE;
+      }
+      size = bytes/sizeof(StateIndex);
+      at   = 0;
+      if (size==0) return FALSE;
+    }
+    value = block[at++];
+    return TRUE;
+  }
+};
+
+class SpillWriter {
+  FILE                   *file;
+  std::vector<StateIndex> block;
+  std::string             name;
+  void Fail(void) {
+    if (ok) std::cerr << name << ": Cannot be written" << std::endl << std::flush;
+    ok = FALSE;
+  }
+public:
+  long count;
+  BOOL ok;
+  SpillWriter(const std::string &nameIn) : name(nameIn),count(0),ok(TRUE) {
+    file = fopen(name.c_str(),"wb");
+    if (file==NULL) Fail();
+    block.reserve(SPILL_BLOCK);
+  }
+  ~SpillWriter(void) { if (file!=NULL) fclose(file); }
+  void Put(StateIndex x) {
+    if (!ok) return;
+    block.push_back(x);
+    count++;
+    if ((int)block.size()==SPILL_BLOCK) Flush();
+  }
+  void Flush(void) {
+    if (ok && !block.empty() && fwrite(&block[0],sizeof(StateIndex),block.size(),file)!=block.size()) Fail();
+    block.clear();
+  }
+  BOOL Close(void) {
+    Flush();
+    if (file!=NULL && fclose(file)!=0) Fail();
+    file = NULL;
+    return ok;
+  }
+};
+
+std::string LeanSearch::NewFile(const char *kind,int number) {
+  char name[64];
+  snprintf(name,sizeof(name),"/%s-%d",kind,number);
+  files.push_back(directory+name);
+  return files.back();
+}
+
+BOOL LeanSearch::WriteRun(std::vector<StateIndex> &buffer) {
+  std::sort(buffer.begin(),buffer.end());
+  buffer.erase(std::unique(buffer.begin(),buffer.end()),buffer.end());
+  SpillWriter run(NewFile("run",(int)files.size()));
+  for (size_t i=0;i<buffer.size();i++) run.Put(buffer[i]);
+  spilled += (long)buffer.size()*(long)sizeof(StateIndex);
+  buffer.clear();
+  return run.Close();
+}
+
+int LeanSearch::DiskSearch(long startIndex) {
+  std::vector<std::string> levels;
+  std::string              seen = NewFile("seen",0);
+  StateIndex               succ[MAX_SUCCESSORS];
+  levels.push_back(NewFile("level",1));
+  {
+    SpillWriter level(levels[0]);
+    SpillWriter all(seen);
+    level.Put((StateIndex)startIndex);
+    all.Put((StateIndex)startIndex);
+    if (!level.Close() || !all.Close()) return -1;
+  }
+  reached = 1;
+  widest  = 1;
+  for (int depth=1;;depth++) {
+    // the successors of the level, in sorted runs
+    std::vector<StateIndex> buffer;
+    size_t                  firstRun = files.size();
+    {
+      SpillReader level(levels[depth-1]);
+      while (level.Next()) {
+        int count = searcher.FreshSuccessors(level.value,succ);
+        for (int k=0;k<count;k++) {
+          if (succ[k]==SUCCESSOR_GOAL) {
+            last = level.value;
+            for (size_t i=firstRun;i<files.size();i++) unlink(files[i].c_str());
+            return TracePath(depth) ? depth : -1;
+          }
+          if (succ[k]<0) continue;
+          buffer.push_back(succ[k]);
+          if ((long)buffer.size()==DISK_BUFFER && !WriteRun(buffer)) return -1;
+        }
+      }
+      if (!level.ok) return -1;
+    }
+    if (!buffer.empty() && !WriteRun(buffer)) return -1;
+    std::vector<std::string> runs(files.begin()+firstRun,files.end());
+    // merge the runs, leaving out the states seen, into the next level, and
+    // the next level into the states seen
+    std::string nextSeen = NewFile("seen",depth);
+    levels.push_back(NewFile("level",depth+1));
+    long count;
+    {
+      std::vector<SpillReader *> readers;
+      SpillReader                old(seen);
+      SpillWriter                level(levels[depth]);
+      SpillWriter                all(nextSeen);
+      BOOL                       oldMore = old.Next();
+      BOOL                       ok      = TRUE;
+      for (size_t i=0;i<runs.size() && ok;i++) {
+        readers.push_back(new SpillReader(runs[i]));
+        if (!readers.back()->Next()) {
+          ok = readers.back()->ok;
+          delete readers.back();
+          readers.pop_back();
+        }
+      }
+      StateIndex previous = -1;
+      while (ok && !readers.empty()) {
+        size_t smallest = 0;
+        for (size_t i=1;i<readers.size();i++) {
+          if (readers[i]->value<readers[smallest]->value) smallest = i;
+        }
+        StateIndex x = readers[smallest]->value;
+        if (!readers[smallest]->Next()) {
+          ok = readers[smallest]->ok;
+          delete readers[smallest];
+          readers.erase(readers.begin()+smallest);
+        }
+        if (x==previous) continue;
+        previous = x;
+        while (oldMore && old.value<x) {
+          all.Put(old.value);
+          oldMore = old.Next();
+        }
+        if (oldMore && old.value==x) continue;
+        level.Put(x);
+        all.Put(x);
+      }
+      // after a failure, the readers left are given up
+      for (size_t i=0;i<readers.size();i++) delete readers[i];
+      while (ok && oldMore) {
+        all.Put(old.value);
+        oldMore = old.Next();
+      }
+      if (!ok || !old.ok || !level.Close() || !all.Close()) return -1;
+      count = level.count;
+    }
+    for (size_t i=0;i<runs.size();i++) unlink(runs[i].c_str());
+    unlink(seen.c_str());
+    seen = nextSeen;
+    if (count==0) return 0;
+    reached += count;
+    if (widest<count) widest = count;
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Trace the solution back from 'last' through the level files of VISITED_DISK
+// into 'path' ('length' states)
+// ---------------------------------------------------------------------------------
+
+BOOL LeanSearch::TracePath(int length) {
+  StateIndex succ[MAX_SUCCESSORS];
+  path = new StateIndex[length];
+  path[length-1] = (StateIndex)last;
+  for (int depth=length-1;depth>=1;depth--) {
+    char name[64];
+    snprintf(name,sizeof(name),"/level-%d",depth);
+    SpillReader level(directory+name);
+    BOOL        found = FALSE;
+    while (!found && level.Next()) {
+      int count = searcher.FreshSuccessors(level.value,succ);
+      for (int k=0;k<count && !found;k++) found = succ[k]==path[depth];
+    }
+    if (!level.ok) return FALSE;
+    if (!found) {
+      std::cerr << "LeanSearch::TracePath(): No predecessor on level " << depth << std::endl << std::flush;
+      return FALSE;
+    }
+    path[depth-1] = level.value;
+  }
+  return TRUE;
+}
+
+// =================================================================================
+// Definitions for "Condensation"
+// =================================================================================
+
+Condensation::Condensation(Searcher &searcher) {
+  typedef std::pair<StateIndex,int> Frame; // state, next successor position
+  long                    total   = Searcher::TotalStates();
+  StateIndex             *order   = new StateIndex[total]; // 0: not visited yet
+  StateIndex             *low     = new StateIndex[total];
+  long                   *seen    = new long[total];       // the component last linked to
+  std::vector<StateIndex> stack;                           // states without a component yet
+  std::vector<Frame>      frames;
+  StateIndex              succ[MAX_SUCCESSORS];
+  StateIndex              visits  = 0;
+  componentCount = 0;
+  component      = new StateIndex[total];
+  dag            = new SuccessorGraph(total);
+  members        = new SuccessorGraph(total);
+  toGoal         = new char[total];
+  loop           = new char[total];
+  memset(order,0,total*sizeof(StateIndex));
+  for (long i=0;i<total;i++) {
+    component[i] = -1;
+    seen[i]      = -1;
+  }
+  for (long root=0;root<total;root++) {
+    if (order[root]!=0 || !searcher.ListedP(root)) continue;
+    order[root] = low[root] = ++visits;
+    stack.push_back((StateIndex)root);
+    frames.push_back(Frame((StateIndex)root,0));
+    while (!frames.empty()) {
+      long index = frames.back().first;
+      int  count = searcher.AllSuccessors(index,succ);
+      BOOL deeper = FALSE;
+      while (frames.back().second<count) {
+        StateIndex w = succ[frames.back().second++];
+        if (w<0) continue;
+        if (order[w]==0) {
+          // descend to the successor, and come back to the next one later
+          order[w] = low[w] = ++visits;
+          stack.push_back(w);
+          frames.push_back(Frame(w,0));
+          deeper = TRUE;
+          break;
+        }
+        if (component[w]<0 && order[w]<low[index]) low[index] = order[w];
+      }
+      if (deeper) continue;
+      frames.pop_back();
+      if (!frames.empty() && low[index]<low[frames.back().first]) low[frames.back().first] = low[index];
+      if (low[index]!=order[index]) continue;
+      // 'index' is the root of a component: its states are on top of the stack
+      long c     = componentCount++;
+      long first = (long)stack.size();
+      do first--; while (stack[first]!=index);
+      for (long k=first;k<(long)stack.size();k++) component[stack[k]] = (StateIndex)c;
+      members->AddState();
+      dag->AddState();
+      toGoal[c] = FALSE;
+      loop[c]   = (long)stack.size()-first>1;
+      for (long k=first;k<(long)stack.size();k++) {
+        members->AddSuccessor(stack[k]);
+        int n = searcher.AllSuccessors(stack[k],succ);
+        for (int i=0;i<n;i++) {
+          if (succ[i]==SUCCESSOR_GOAL) toGoal[c] = TRUE;
+          if (succ[i]<0) continue;
+          long d = component[succ[i]];
+          if (d==c) {
+            if (succ[i]==stack[k]) loop[c] = TRUE;
+          }
+          else if (seen[d]!=c) {
+            seen[d] = c;
+            dag->AddSuccessor((StateIndex)d);
+            if (toGoal[d]) toGoal[c] = TRUE;
+          }
+        }
+      }
+      stack.resize(first);
+    }
+  }
+  dag->Shrink();
+  members->Shrink();
+  delete[] order;
+  delete[] low;
+  delete[] seen;
+}
+
+Condensation::~Condensation(void) {
+  delete[] component;
+  delete dag;
+  delete members;
+  delete[] toGoal;
+  delete[] loop;
+}
+
+// ---------------------------------------------------------------------------------
+// Set reached[c] for the components reached from state 'index' (itself
+// included), clear it for the others; 'reached' has Components() entries
+// ---------------------------------------------------------------------------------
+
+void Condensation::Reachable(long index,char *reached) const {
+  memset(reached,0,componentCount);
+  long start = component[index];
+  if (start<0) return;
+  reached[start] = TRUE;
+  for (long c=start;c>=0;c--) {
+    if (!reached[c]) continue;
+    const StateIndex *first;
+    int count = dag->Successors(c,first);
+    for (int i=0;i<count;i++) reached[first[i]] = TRUE;
+  }
+}
+
+// =================================================================================
+// Definitions for the benchmarks
+// =================================================================================
+
+const int BENCH_BUILD = 0;
+const int BENCH_DFS   = 1;
+const int BENCH_BFS   = 2;
+const int BENCH_BIDIR = 3;
+
+struct BenchEngine {
+  const char *name;
+  int         tableMode;
+  BOOL        parallel;
+  int         run;
+};
+
+const int         BENCH_ENGINE_COUNT = 8;
+const BenchEngine BENCH_ENGINE[BENCH_ENGINE_COUNT] = {
+  { "build dense",TABLE_DENSE,  FALSE,BENCH_BUILD },
+  { "build dense",TABLE_DENSE,  TRUE, BENCH_BUILD },
+  { "build csr",  TABLE_COMPACT,FALSE,BENCH_BUILD },
+  { "dfs",        TABLE_DENSE,  FALSE,BENCH_DFS   },
+  { "bfs",        TABLE_DENSE,  FALSE,BENCH_BFS   },
+  { "bfs",        TABLE_DENSE,  TRUE, BENCH_BFS   },
+  { "bidir",      TABLE_DENSE,  FALSE,BENCH_BIDIR },
+  { "bfs lazy",   TABLE_LAZY,   FALSE,BENCH_BFS   }
+};
+
+// ---------------------------------------------------------------------------------
+// Run one measurement in the child process and print its figures; the output
+// of the searcher itself is discarded
+// ---------------------------------------------------------------------------------
+
+static void BenchmarkChild(const BenchEngine &engine,int threads) {
+  typedef std::chrono::steady_clock Clock;
+  std::streambuf *out = std::cout.rdbuf(NULL);
+  std::streambuf *err = std::cerr.rdbuf(NULL);
+  Clock::time_point begin = Clock::now();
+  Searcher         *x     = new Searcher(engine.tableMode,threads);
+  if (engine.run==BENCH_BIDIR) x->BuildReverseGraph();
+  Clock::time_point built = Clock::now();
+  switch (engine.run) {
+  case BENCH_DFS:   x->StartTraversal();              break;
+  case BENCH_BFS:   x->StartBfsTraversal();           break;
+  case BENCH_BIDIR: x->StartBidirectionalTraversal(); break;
+  }
+  Clock::time_point end = Clock::now();
+  std::cout.rdbuf(out);
+  std::cerr.rdbuf(err);
+
+  long   total   = 1L << State::IndexBits();
+  long   states  = (engine.run==BENCH_BUILD) ? total : x->VisitedCount();
+  double seconds = std::chrono::duration<double>(
+    (engine.run==BENCH_BUILD) ? built-begin :
+    (engine.tableMode==TABLE_LAZY) ? end-begin : end-built).count();
+  struct rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+  char line[160];
+  snprintf(line,sizeof(line),"%10.1f %10.1f %12.0f %10ld %8.1f %8.1f",
+           seconds*1e3,(states>0) ? seconds*1e9/states : 0.0,
+           (seconds>0) ? states/seconds : 0.0,states,
+           usage.ru_maxrss/1024.0,(double)x->TableBytes()/total);
+  std::cout << line << std::endl << std::flush;
+}
+
+// ---------------------------------------------------------------------------------
+// Measure 'engine' on the installed maze in a child process; reports a child
+// that does not end normally
+// ---------------------------------------------------------------------------------
+
+static void Benchmark(const BenchEngine &engine,int threads) {
+  std::cout << std::flush;
+  pid_t child = fork();
+  if (child<0) {
+    std::cout << "cannot fork" << std::endl << std::flush;
+    return;
+  }
+  if (child==0) {
+    struct rlimit limit;
+    limit.rlim_cur = limit.rlim_max = 4*BENCH_MEMORY_LIMIT;
+    setrlimit(RLIMIT_AS,&limit);
+    alarm(BENCH_TIMEOUT);
+    try {
+      BenchmarkChild(engine,threads);
+    }
+    catch (std::bad_alloc &) {
+      _exit(2);
+    }
+    _exit(0);
+  }
+  int status;
+  waitpid(child,&status,0);
+  if (WIFSIGNALED(status) && WTERMSIG(status)==SIGALRM) {
+    std::cout << "timed out after " << BENCH_TIMEOUT << " s" << std::endl << std::flush;
+  }
+  else if (WIFSIGNALED(status)) {
+    std::cout << "failed (signal " << WTERMSIG(status) << ")" << std::endl << std::flush;
+  }
+  else if (WIFEXITED(status) && WEXITSTATUS(status)==2) {
+    std::cout << "out of memory" << std::endl << std::flush;
+  }
+  else if (!WIFEXITED(status) || WEXITSTATUS(status)!=0) {
+    std::cout << "failed" << std::endl << std::flush;
+  }
+}
+
+// ---------------------------------------------------------------------------------
+// Run all engines on 'maze' if it was 'built' (it is not if its states do not fit
+// into a state index)
+// ---------------------------------------------------------------------------------
+
+static void BenchmarkMaze(const Maze &maze,BOOL built,const char *kind,int boxes,int pencils,int threads) {
+  std::ostringstream mazeName;
+  char               line[160];
+  mazeName << boxes << " " << kind << ", " << pencils << "p";
+  if (!built) {
+    snprintf(line,sizeof(line),"%-22s %-16s ",mazeName.str().c_str(),"-");
+    std::cout << line << "skipped: does not fit a state index" << std::endl << std::flush;
+    return;
+  }
+  Maze::Install(maze);
+  long total = 1L << State::IndexBits();
+  for (int e=0;e<BENCH_ENGINE_COUNT;e++) {
+    const BenchEngine &engine = BENCH_ENGINE[e];
+    std::ostringstream engineName;
+    engineName << engine.name;
+    if (engine.parallel) engineName << " x" << threads;
+    snprintf(line,sizeof(line),"%-22s %-16s ",mazeName.str().c_str(),engineName.str().c_str());
+    std::cout << line;
+    // estimated bytes per state of the tables and search columns
+    long perState = 0;
+    if (engine.tableMode==TABLE_DENSE)   perState = sizeof(Transition)+sizeof(int)+sizeof(StateIndex);
+    if (engine.tableMode==TABLE_COMPACT) perState = sizeof(int)+sizeof(StateIndex)+4*MAX_SUCCESSORS;
+    if (engine.run==BENCH_BIDIR) perState += 8*MAX_SUCCESSORS;
+    if (perState>BENCH_MEMORY_LIMIT/total) {
+      std::cout << "skipped: tables too large" << std::endl << std::flush;
+      continue;
+    }
+    Benchmark(engine,engine.parallel ? threads : 1);
+  }
+}
+
+void RunBenchmarks(int threads) {
+  const int  SIZE_COUNT = 4;
+  const int  COPIES[SIZE_COUNT] = { 1,7,63,625 };
+  const int  BOXES[SIZE_COUNT]  = { 16,100,1000,10000 };
+  Maze       builtin;
+  char       line[160];
+  if (threads<1) threads = 1;
+  snprintf(line,sizeof(line),"%-22s %-16s %10s %10s %12s %10s %8s %8s",
+           "maze","engine","time ms","ns/state","states/s","states","RSS MB","B/state");
+  std::cout << line << std::endl;
+  for (int s=0;s<SIZE_COUNT;s++) {
+    for (int pencils=2;pencils<=MAX_PENCILS;pencils++) {
+      Maze               chained;
+      Maze               generated;
+      std::ostringstream errors;
+      BOOL               built = chained.Chain(builtin,COPIES[s],pencils,errors);
+      BenchmarkMaze(chained,built,"chained",COPIES[s]*builtin.BoxCount(),pencils,threads);
+      built = generated.Generate(BOXES[s],BENCH_BRANCHING,BENCH_SEED,pencils,errors);
+      BenchmarkMaze(generated,built,"random",BOXES[s],pencils,threads);
+    }
+  }
+  Maze::Install(builtin);
+  std::cout << std::flush;
+}
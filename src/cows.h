@@ -0,0 +1,1933 @@
+// =================================================================================
+// Solution to maze problem in Scientific American, December 1996:
+// Maze with linked nodes, with arcs labeled 'Yes', 'No', and
+// self-referential rules in the boxes. The goal is to put a 'pencil'
+// in box 1 and one in box 7 then reach a 'goal state' with either
+// one of the pencils.
+// =================================================================================
+// The declarations of the solver: the maze, the states and transitions, the
+// searcher and its engines. 'src/cows.cpp' has the definitions and can be built
+// as a library; 'src/main.cpp' is the command line program.
+// =================================================================================
+
+#ifndef COWS_H
+#define COWS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <type_traits>
+#include <assert.h>
+
+typedef int BOOL;
+
+static const int TRUE  = 1;
+static const int FALSE = 0;
+
+// =================================================================================
+// Codes for special maze points (box numbers are never negative) and the start
+// positions of the pencils in the built-in maze
+// =================================================================================
+
+const int GOAL_MAZEPOINT        = -1;
+const int ILLEGAL_MAZEPOINT     = -2;
+const int START_PENCIL_0        = 1;
+const int START_PENCIL_1        = 7;
+
+// =================================================================================
+// Codes for paths
+// =================================================================================
+
+const int PATH_YES    = 0; // Yes has been taken (no choice)
+const int PATH_NO     = 1; // No has been taken (no choice)
+const int PATH_LUGNUT = 2; // both Yes & LUGNUT can be taken (choice)
+const int PATH_NONE   = 3; // in case of deadly embrace - no exit
+
+// =================================================================================
+// Codes for maze points of the built-in maze (see "Maze" for mazes read from a
+// file)
+// =================================================================================
+
+constexpr int MAZEPOINT_COUNT            = 16;
+constexpr int MAZEPOINT[MAZEPOINT_COUNT] = {1,2,5,7,9,15,25,26,35,40,50,55,60,61,65,75};
+
+// =================================================================================
+// Reverse lookup table for maze points, generated at compile time from 'MAZEPOINT':
+// 'MAZEPOINT_INDEX.index[x]' is the index of mazepoint 'x' in the 'MAZEPOINT' array
+// or -1 if 'x' is not a mazepoint. 'MAZEPOINT' itself is the inverse table. Both
+// are consistent by construction; the static_assert below makes sure that no box
+// number appears twice. At run time, the lookup is done by the "Maze", which
+// builds the same table for whatever maze it holds.
+// =================================================================================
+
+constexpr int MaxMazePoint(void) {
+  int result = 0;
+  for (int i=0;i<MAZEPOINT_COUNT;i++) {
+    if (result<MAZEPOINT[i]) result=MAZEPOINT[i];
+  }
+  return result;
+}
+
+constexpr int MAZEPOINT_MAX = MaxMazePoint();
+
+struct MazePointIndexTable {
+  short index[MAZEPOINT_MAX+1];
+};
+
+constexpr MazePointIndexTable MakeMazePointIndexTable(void) {
+  MazePointIndexTable result = {};
+  for (int x=0;x<=MAZEPOINT_MAX;x++) {
+    result.index[x] = -1;
+  }
+  for (int i=0;i<MAZEPOINT_COUNT;i++) {
+    result.index[MAZEPOINT[i]] = (short)i;
+  }
+  return result;
+}
+
+constexpr MazePointIndexTable MAZEPOINT_INDEX = MakeMazePointIndexTable();
+
+constexpr bool MazePointIndexConsistentP(void) {
+  for (int i=0;i<MAZEPOINT_COUNT;i++) {
+    if (MAZEPOINT[i]<0 || MAZEPOINT_INDEX.index[MAZEPOINT[i]]!=i) return false;
+  }
+  return true;
+}
+
+static_assert(MazePointIndexConsistentP(),"MAZEPOINT contains duplicate or negative box numbers");
+static_assert(GOAL_MAZEPOINT<0 && ILLEGAL_MAZEPOINT<0,
+              "box numbers collide with the special maze point codes");
+
+// =================================================================================
+// Properties of the boxes, one bit each, as asked about by the rules of the 
+// boxes. The number properties are not listed in the rule table but derived
+// from the box number (see Maze::Properties()).
+// =================================================================================
+
+const unsigned PROP_RED_TEXT         = 1u<<0; // the text is red
+const unsigned PROP_GREEN_TEXT       = 1u<<1; // the text is green
+const unsigned PROP_WORD_RED         = 1u<<2; // the text has the word "red"
+const unsigned PROP_WORD_GREEN       = 1u<<3; // the text has the word "green"
+const unsigned PROP_WORD_WORD        = 1u<<4; // the text has the word "word"
+const unsigned PROP_REFERS_TO_COWS   = 1u<<5; // the text refers to cows
+const unsigned PROP_IF_SENTENCE      = 1u<<6; // the text begins with "If"
+const unsigned PROP_ODD_NUMBER       = 1u<<7; // the box number is odd
+const unsigned PROP_MULTIPLE_OF_FIVE = 1u<<8; // the box number is divisible by 5
+
+// =================================================================================
+// Kinds of box rules, i.e. how the rule in a box decides on the exit path
+// =================================================================================
+
+const int RULE_OTHER_HAS      = 0; // Yes if the other pencil's box has any of 'mask'
+const int RULE_SELF_HAS       = 1; // Yes if this box has any of 'mask'
+const int RULE_OTHER_MOVED    = 2; // Yes if the other pencil moved in the last round
+const int RULE_COUNTERFACTUAL = 3; // Yes if the other pencil would exit on No
+const int RULE_CHOICE         = 4; // free choice between Yes and the 'no' exit
+const int RULE_ALWAYS         = 5; // always Yes
+const int RULE_FLAG_SET       = 6; // Yes if rule flag 'flag' is active
+
+// =================================================================================
+// Special effects of box rules, applied when the rule is followed
+// =================================================================================
+
+const unsigned EFFECT_SET_RULE60   = 1u<<0; // rule 60 becomes active
+const unsigned EFFECT_CLEAR_RULE60 = 1u<<1; // rule 60 becomes inactive
+const unsigned EFFECT_MOVE_OTHER   = 1u<<2; // the other pencil moves on its Yes path
+const unsigned EFFECT_SET_FLAG     = 1u<<3; // rule flag 'flag' becomes active
+const unsigned EFFECT_CLEAR_FLAG   = 1u<<4; // rule flag 'flag' becomes inactive
+
+// =================================================================================
+// Limits of the generalized puzzle: up to MAX_PENCILS pencils, and up to
+// MAX_FLAGS rule flags that boxes may switch on and off. Flag 0 is rule 60 of
+// the puzzle: as long as it is active, red text is ignored. The other flags have
+// no meaning of their own; boxes test them with RULE_FLAG_SET. The "other
+// pencil" of pencil 'p' is pencil '(p+1)%pencils', so with two pencils it is
+// just the other one.
+// =================================================================================
+
+const int MAX_PENCILS = 4;
+const int MAX_FLAGS   = 8;
+const int FLAG_RULE60 = 0;
+
+// =================================================================================
+// The rule of a box: the exit is decided by kind 'kind' (tested properties in
+// 'mask'), leading to box 'yes' or box 'no' ('no' is the alternate "LUGNUT" exit
+// for RULE_CHOICE), and 'effects' are applied. 'properties' describes the text
+// of the box. As long as rule 60 is active, the rules of boxes with red text are
+// not followed: their pencil just exits on Yes, without any effects. 'flag' is
+// the rule flag tested by RULE_FLAG_SET and switched by EFFECT_SET_FLAG and
+// EFFECT_CLEAR_FLAG.
+// =================================================================================
+
+struct BoxRule {
+  int      number;
+  int      kind;
+  unsigned mask;
+  int      yes;
+  int      no;
+  unsigned effects;
+  unsigned properties;
+  int      flag;
+};
+
+// =================================================================================
+// The built-in maze, in the order of MAZEPOINT (this is what "Maze" holds unless
+// a maze is read from a file)
+// =================================================================================
+
+constexpr BoxRule MAZE_RULES[MAZEPOINT_COUNT] = {
+  // Box 1: "Does the other pencil point to a box that has either red text or
+  // green text?"
+  { 1,RULE_OTHER_HAS,PROP_RED_TEXT|PROP_GREEN_TEXT,2,9,0,
+    PROP_WORD_RED|PROP_WORD_GREEN,0 },
+  // Box 2: "Does the other pencil point to a box that has green text or has the
+  // word "green"?"
+  { 2,RULE_OTHER_HAS,PROP_GREEN_TEXT|PROP_WORD_GREEN,7,15,0,
+    PROP_WORD_GREEN,0 },
+  // Box 5: "Does the other pencil point to text that has the word "red" or the
+  // word "green"?"
+  { 5,RULE_OTHER_HAS,PROP_WORD_RED|PROP_WORD_GREEN,25,2,0,
+    PROP_WORD_RED|PROP_WORD_GREEN|PROP_WORD_WORD,0 },
+  // Box 7 (red text): "Is the other pencil in a box whose number is an odd
+  // number?"
+  { 7,RULE_OTHER_HAS,PROP_ODD_NUMBER,26,5,0,
+    PROP_RED_TEXT,0 },
+  // Box 9 (red text): "On the last turn, did you move the other pencil?"
+  { 9,RULE_OTHER_MOVED,0,2,35,0,
+    PROP_RED_TEXT,0 },
+  // Box 15: "Is the other pencil in a box whose number is evenly divisible by 5?"
+  { 15,RULE_OTHER_HAS,PROP_MULTIPLE_OF_FIVE,5,40,0,
+    0,0 },
+  // Box 25 (red text): "Does the other pencil point to a box that has either
+  // red text or green text?"
+  { 25,RULE_OTHER_HAS,PROP_RED_TEXT|PROP_GREEN_TEXT,7,50,0,
+    PROP_RED_TEXT|PROP_WORD_RED|PROP_WORD_GREEN,0 },
+  // Box 26 (red text): "If you had chosen the other pencil, would it exit on a
+  // path marked "NO"?"
+  { 26,RULE_COUNTERFACTUAL,0,61,55,0,
+    PROP_RED_TEXT|PROP_IF_SENTENCE,0 },
+  // Box 35: "Does the other pencil point to text that has the word "word"?"
+  { 35,RULE_OTHER_HAS,PROP_WORD_WORD,40,1,0,
+    PROP_WORD_WORD,0 },
+  // Box 40 (red text): "Is the text in this box green?"
+  { 40,RULE_SELF_HAS,PROP_GREEN_TEXT,65,60,0,
+    PROP_RED_TEXT|PROP_WORD_GREEN,0 },
+  // Box 50 (red text): "Does the other pencil point to text that refers to
+  // cows?"
+  { 50,RULE_OTHER_HAS,PROP_REFERS_TO_COWS,GOAL_MAZEPOINT,26,0,
+    PROP_RED_TEXT|PROP_REFERS_TO_COWS,0 },
+  // Box 55: "Free choice: Exit either on the path marked "Yes" or on the path
+  // marked "LUGNUT""
+  { 55,RULE_CHOICE,0,15,7,0,
+    0,0 },
+  // Box 60 (green text): "Until further notice, make this change in the rules:
+  // If you choose a pencil that points to a red text, ignore what the text says.
+  // Just exit on the path marked "yes". Now exit from this box on the path
+  // marked "Yes"."
+  { 60,RULE_ALWAYS,0,25,25,EFFECT_SET_RULE60,
+    PROP_GREEN_TEXT|PROP_WORD_RED,0 },
+  // Box 61 (red text): "If you choose this box, ignore the text the other pencil
+  // points to. Move the other pencil on the path marked "Yes". Then move this
+  // pencil on the path marked "yes"."
+  { 61,RULE_ALWAYS,0,1,1,EFFECT_MOVE_OTHER,
+    PROP_RED_TEXT|PROP_IF_SENTENCE,0 },
+  // Box 65: "If the rule stated in green in Box 60 is now in effect, cancel that
+  // rule. Until further notice, when you choose a box with red text, follow what
+  // the text says. Now exit from this box on the path marked "Yes"."
+  { 65,RULE_ALWAYS,0,75,75,EFFECT_CLEAR_RULE60,
+    PROP_WORD_RED|PROP_WORD_GREEN|PROP_IF_SENTENCE,0 },
+  // Box 75: "Does the other pencil point to text that begins "If"?"
+  { 75,RULE_OTHER_HAS,PROP_IF_SENTENCE,1,50,0,
+    0,0 }
+};
+
+constexpr bool MazeRulesConsistentP(void) {
+  for (int i=0;i<MAZEPOINT_COUNT;i++) {
+    const BoxRule &rule = MAZE_RULES[i];
+    if (rule.number!=MAZEPOINT[i]) return false;
+    if (rule.yes!=GOAL_MAZEPOINT && (rule.yes>MAZEPOINT_MAX || MAZEPOINT_INDEX.index[rule.yes]<0)) return false;
+    if (rule.no!=GOAL_MAZEPOINT  && (rule.no>MAZEPOINT_MAX  || MAZEPOINT_INDEX.index[rule.no]<0))  return false;
+  }
+  return true;
+}
+
+static_assert(MazeRulesConsistentP(),"MAZE_RULES does not match MAZEPOINT or leads to unknown boxes");
+
+// =================================================================================
+// A maze: its boxes with their rules and the start positions of the pencils. The
+// boxes carry the numbers given by the maze's author; they are indexed from 0 to
+// BoxCount()-1 in the order in which they are defined, and states refer to the
+// boxes by index. A Maze is the built-in maze (MAZE_RULES) unless one is read
+// from a maze description file with Load().
+//
+// A maze is also played with a given number of pencils (2 in the puzzle) and a
+// given number of rule flags (1 in the puzzle, rule 60).
+//
+// The maze that "State" and "Searcher" work on is the one passed to Install();
+// installing a maze determines the layout of "State" (the number of bits for a
+// box index, the number of pencils and flags). The maze must remain in
+// existence as long as it is installed.
+// =================================================================================
+// Load(const char *fileName,std::ostream &err):
+//   read a maze description file (see below), replacing the current content.
+//   On errors, a message is written to 'err' and FALSE returned.
+// Write(std::ostream &os):
+//   write the maze in the format read by Load().
+// Chain(const Maze &base,int copies,int pencils,std::ostream &err):
+//   replace the content by 'copies' copies of maze 'base', played with
+//   'pencils' pencils. Copy i has the box numbers of 'base' plus CHAIN_OFFSET*i
+//   (which keeps the number properties); an exit to the goal leads to the
+//   first box of the next copy instead, except in the last copy. The pencils
+//   start in copy 0, those beyond the ones of 'base' in its boxes 1, 2, ...
+//   Used to build large mazes for benchmarking.
+// Generate(int boxes,int branching,unsigned long seed,int pencils,std::ostream &err):
+//   replace the content by a random maze of boxes 1 to 'boxes', played with
+//   'pencils' pencils, built from the rule families of the puzzle. About one
+//   box in GENERATE_SPECIAL_EVERY each sets rule 60 (like box 60), clears it
+//   (like 65), moves the other pencil (like 61), is counterfactual (like 26)
+//   and is a free choice (like 55). Of the other boxes, 'branching' percent
+//   test a property of the other pencil's box (its text colour, its words or
+//   its number) or of their own box, or whether the other pencil moved; the
+//   rest always exit on Yes. The texts and the exits are random, and one box
+//   leads to the goal if the other pencil points to text that refers to cows
+//   (like 50). The same arguments always give the same maze.
+// Edit(const std::string &line,const char *name,std::ostream &err,int &edited):
+//   replace the rule of a box by the one of 'line', a "box" line of the maze
+//   description format (see below), and set 'edited' to the index of the box.
+//   The box must exist already, so the boxes, and with them the layout of
+//   "State", stay the same; an installed maze may be edited. On errors, a
+//   message ('name' being the origin of 'line') is written to 'err', the maze
+//   is left as it was and FALSE returned.
+// BoxCount(void),Number(int i),Rule(int i),Start(int pencil):
+//   the number of boxes, the number and the rule of the box with index 'i',
+//   the box number at which 'pencil' starts.
+// PencilCount(void),FlagCount(void):
+//   the number of pencils and of rule flags.
+// Index(int number):
+//   the index of the box with number 'number'; a lookup in a table covering all
+//   numbers up to the largest one. 'number' is only validated in debug builds.
+// BoxP(int number):
+//   is there a box with number 'number'?
+// OtherYesP(int self,int other):
+//   does the RULE_OTHER_HAS rule of the box with index 'self' exit on Yes when
+//   the other pencil is at the box with index 'other'? A bit test in the rule
+//   table, which Finish() builds with MaskColumn(): a bit column over the boxes
+//   for every RULE_OTHER_HAS box (all 0 for the other boxes).
+// OtherYesColumn(int self):
+//   the column of the rule table for the box with index 'self': bit 'other' is
+//   OtherYesP(self,other), (BoxCount()+63)/64 words.
+// OtherHasMasks(void):
+//   the mask of the RULE_OTHER_HAS rule of every box (0 for the other boxes),
+//   BoxCount() words; the rule table is built from these.
+// Properties(int i):
+//   the property word of the box with index 'i', including the properties that
+//   follow from the box number.
+// IndexBits(int boxCount,int pencilCount,int flagCount):
+//   the number of bits of a state index for such a maze (see "State").
+// =================================================================================
+// Maze description file format:
+//
+// Everything from a '#' to the end of the line is ignored. Otherwise, there is
+// one "start" line, an optional "flags" line and one "box" line per box:
+//
+//   start <box> <box> ...
+//   flags <count>
+//   box <number> <kind> yes <target> [no <target>] [effects <list>] [text <list>]
+//       [flag <flag>]
+//
+// The "start" line gives the start box of every pencil (2 to MAX_PENCILS of
+// them), "flags" the number of rule flags (1 to MAX_FLAGS, default 1).
+// <kind> is one of "other-has <list>", "self-has <list>", "other-moved",
+// "counterfactual", "choice", "always" and "flag-set" (see RULE_...), the
+// <list> after "other-has" and "self-has" is the list of properties tested. A
+// <target> is a box number or "goal"; "no" is the "LUGNUT" exit for "choice"
+// and not needed for "always". A <list> is a comma-separated list without
+// blanks of effect names ("set-rule60", "clear-rule60", "move-other",
+// "set-flag", "clear-flag") or property names ("red-text", "green-text",
+// "word-red", "word-green", "word-word", "refers-to-cows", "if-sentence",
+// "odd-number", "multiple-of-five"); "text" gives the properties of the box
+// itself. "flag" gives the rule flag for "flag-set", "set-flag" and
+// "clear-flag" (default 0).
+// =================================================================================
+
+class Maze {
+
+private:
+
+  int       boxCount;
+  BoxRule  *rules;
+  unsigned *properties;
+  int       maxNumber;
+  int      *index;        // box number -> box index or -1, maxNumber+1 entries
+  unsigned long long *otherYes; // the rule table, yesWords words per box
+  int                 yesWords;
+  unsigned           *otherMask; // the other-has masks, one per box
+  int       pencilCount;
+  int       flagCount;
+  int       start[MAX_PENCILS];
+
+  static const Maze *current;
+
+  void Clear(void);
+  BOOL Finish(const char *name,std::ostream &err);
+
+  // for "MazeImage", which calls Finish() itself
+  Maze(const BoxRule *rules,int boxCount,int pencilCount,int flagCount,const int *start);
+
+  friend class MazeImage;
+
+  // undefined and cannot be called
+
+  Maze(const Maze &old);
+  Maze &operator=(const Maze &old);
+
+public:
+
+  Maze(void);
+  ~Maze(void);
+
+  BOOL Load(const char *fileName,std::ostream &err);
+  BOOL Parse(std::istream &is,const char *name,std::ostream &err);
+  void Write(std::ostream &os) const;
+  BOOL Chain(const Maze &base,int copies,int pencils,std::ostream &err);
+  BOOL Generate(int boxes,int branching,unsigned long seed,int pencils,std::ostream &err);
+  BOOL Edit(const std::string &line,const char *name,std::ostream &err,int &edited);
+
+  int            BoxCount(void)      const;
+  int            Number(int i)       const;
+  int            Index(int number)   const;
+  BOOL           BoxP(int number)    const;
+  BOOL           OtherYesP(int self,int other) const;
+  const unsigned long long *OtherYesColumn(int self) const;
+  const unsigned           *OtherHasMasks(void)      const;
+  const BoxRule &Rule(int i)         const;
+  unsigned       Properties(int i)   const;
+  int            Start(int pencil)   const;
+  int            PencilCount(void)   const;
+  int            FlagCount(void)     const;
+  const BoxRule *Rules(void)         const;
+
+  static void        Install(const Maze &maze);
+  static const Maze &Current(void);
+  static int         IndexBits(int boxCount,int pencilCount,int flagCount);
+
+};
+
+// =================================================================================
+// Description of a state in the state space: every pencil is on some mazepoint,
+// every rule flag (rule 60 is flag 0) is activated (or not), and every pencil
+// moved in the last round (or not). With the puzzle's two pencils and one flag:
+// pencil 0 is on some mazepoint, pencil 1 is on some mazepoint, rule 60 is
+// activated (or not), and pencil 0 or pencil 1 or both moved in the last round.
+// =================================================================================
+// GetMazePointIndex(int x): Get the index of mazepoint 'x' in the installed
+//                           maze. (ILLEGAL_MAZEPOINT & GOAL_MAZEPOINT do not have
+//                           any mazepoint index, of course). This is a table
+//                           lookup (see Maze::Index()); 'x' is only validated in
+//                           debug builds (i.e. if NDEBUG is not defined).
+// Pencil(int pencil):       Get the mazepoint which 'pencil' is at. This is
+//                           either a box number of the installed maze or else
+//                           'ILLEGAL_MAZEPOINT' or 'GOAL_MAZEPOINT'.
+// BoxIndex(int pencil):     Get the index of the box which 'pencil' is at; the
+//                           pencil must not be at ILLEGAL_MAZEPOINT or
+//                           GOAL_MAZEPOINT.
+// MovementP(int pencil):    Did 'pencil' move in the last round?
+// FlagP(int flag):          Is rule flag 'flag' active?
+// Rule60P(void) :           Is rule 60 (flag 0) active?
+// IllegalP(void):           Is this an illegal state (any pencil at
+//                           'ILLEGAL_MAZEPOINT')?
+// GoalP(void):              Is this a goal state (any pencil at 'GOAL_MAZEPOINT')?
+// SetPencil(int p,int mp):  Set pencil 'p' to mazepoint 'mp'. 'mp' must be
+//                           either a box number of the installed maze or else
+//                           'ILLEGAL_MAZEPOINT' or 'GOAL_MAZEPOINT'.
+// SetFlag(int f,BOOL x):    Set or unset rule flag 'f'.
+// SetRule60(BOOL x):        Set or unset rule 60.
+// SetMovement(int p,BOOL x):Record movement for pencil 'p'.
+// Index(void):              Get the index of this state in the state space. Only
+//                           meaningful for states that are neither illegal nor
+//                           goal states.
+// FromIndex(long i):        Get the state which has index 'i'.
+// ValidIndexP(long i):      Does index 'i' denote a state? (It does not if a
+//                           pencil index is beyond the number of boxes.)
+// BoxStates(void),IndexWithBox(long i,int p,int box):
+//                           The number of state indexes in which a given pencil
+//                           is at a given box, and the i-th of those in which
+//                           pencil 'p' is at the box with index 'box' (i from 0
+//                           to BoxStates()-1). They are not all valid.
+// SetLayout(int boxCount,int pencils,int flags):
+//                           Set up the packing for a maze of 'boxCount' boxes
+//                           played with 'pencils' pencils and 'flags' rule
+//                           flags (done by Maze::Install()).
+// IndexBits(void),Pencils(void),Flags(void):
+//                           The number of bits of a state index, the number of
+//                           pencils and the number of rule flags.
+// Rotated(int by):          Get the state in which pencil 'p' is where pencil
+//                           '(p+by)%Pencils()' is in this state, moved if that
+//                           pencil moved. Only for states that are neither
+//                           illegal nor goal states.
+// =================================================================================
+// Internal:
+// The state is packed into a word whose low 'indexBits' bits are the index of
+// the state in the state space. From the least significant bit on, with K
+// pencils and F flags:
+//
+//   rule flags F-1 .. 0               1 bit each (rule 60 is the lowest bit)
+//   pencil K-1 .. 0, index of its box 'pencilBits' bits each
+//   pencil K-1 .. 0 moved             1 bit each
+//   ---- beyond the index:
+//   pencil K-1 .. 0 at ILLEGAL_...    1 bit each
+//   pencil K-1 .. 0 at GOAL_MAZEPOINT 1 bit each
+//
+// So the state space has 2^(K*pencilBits+K+F) states, 'pencilBits' being the
+// number of bits needed for a box index of the installed maze. A pencil at
+// ILLEGAL_MAZEPOINT or GOAL_MAZEPOINT has a 0 in its index field. Pencil and
+// flag numbers are only checked in debug builds.
+// =================================================================================
+
+constexpr int BitsNeeded(int count) {
+  int result = 0;
+  while ((1<<result)<count) result++;
+  return result;
+}
+
+const int STATE_MAX_INDEX_BITS = 31; // so that indexes fit a "StateIndex"
+
+class State {
+
+private:
+
+  unsigned long code;
+
+  static int           pencils;
+  static int           flags;
+  static int           pencilBits;
+  static int           indexBits;
+  static int           pencilShift[MAX_PENCILS];
+  static int           movedBit[MAX_PENCILS];
+  static unsigned long pencilMask;
+  static unsigned long indexMask;
+  static unsigned long illegalBit[MAX_PENCILS];
+  static unsigned long goalBit[MAX_PENCILS];
+  static unsigned long illegalMask;
+  static unsigned long goalMask;
+
+public:
+
+  static int   GetMazePointIndex(int mp);
+  static State FromIndex(long index);
+  static BOOL  ValidIndexP(long index);
+  static long  BoxStates(void);
+  static long  IndexWithBox(long i,int pencil,int box);
+  static void  SetLayout(int boxCount,int pencils,int flags);
+  static int   IndexBits(void);
+  static int   Pencils(void);
+  static int   Flags(void);
+
+  State(void);
+
+  int  Pencil(int pencil)    const;
+  int  BoxIndex(int pencil)  const;
+  BOOL MovementP(int pencil) const;
+  BOOL FlagP(int flag)       const;
+  BOOL Rule60P(void)         const;
+
+  BOOL IllegalP(void)        const;
+  BOOL GoalP(void)           const;
+
+  void SetPencil(int pencil,int mp);
+  void SetMovement(int pencil,BOOL x);
+  void SetFlag(int flag,BOOL x);
+  void SetRule60(BOOL x);
+
+  long  Index(void)          const;
+  State Rotated(int by)      const;
+
+};
+
+std::ostream &operator<<(std::ostream &os,const State &s);
+
+// =================================================================================
+// Description of a state transition:
+//
+// Given a 'current state', one can either choose to follow
+// the rule at the maze point given by pencil 0, or one can follow the rule in 
+// the maze point given by pencil 1. In case of a (rare) nondeterministic choice,
+// an alternate state can be the result for pencil 0, or else an alternate state can
+// be the result for pencil 1.
+//
+// With more than two pencils, there is a next state (and maybe an alternate
+// one) for each of them.
+//
+// A Transition is the current state (its packed code, 8 bytes) followed by the
+// exit path (PATH_YES, PATH_NO, PATH_LUGNUT or PATH_NONE) taken by the rule of
+// each pencil's box, a byte for each of the MAX_PENCILS pencils; 16 bytes with
+// the padding. The exit paths are computed once per state (see
+// Searcher::ExitPaths()) and are what the counterfactual boxes look up.
+// Evaluating the rules is the expensive part; the next states follow from the
+// current state and the exit path with a few bit operations, so they are not
+// stored but derived when asked for.
+//
+// When the Transition was visited by the state search algorithm is not recorded
+// here but in the 'visited' column of the "Searcher".
+// =================================================================================
+// SetCurrentState(const State &current):
+//   set the 'current' state (i.e. the state at which this transition may be 
+//   applied). Its index is the position of the Transition in a table.
+// SetExitPath(int chosenPencil,int path):
+//   set the exit path taken by the rule pointed to by pencil 'chosenPencil'.
+// CurrentState(void),ExitPath(int chosenPencil):
+//   retrieve the 'current' state and the exit path.
+// NextState(int chosenPencil):
+//   the next state that is reached by applying the rule pointed to by pencil
+//   'chosenPencil', given the 'current' state and the exit path. The
+//   application of such a rule corresponds to traversal of an arc in the
+//   state space.
+// AltNextValidP(int chosenPencil),AltNextState(int chosenPencil):
+//   whether there is a nondeterministic choice (the exit path is PATH_LUGNUT)
+//   and the alternate next state reached then.
+// =================================================================================
+
+class Transition {
+
+private:
+
+  State         current;
+  unsigned char exitPath[MAX_PENCILS];
+
+  State Successor(int chosenPencil,BOOL alternate) const;
+
+public:
+
+  Transition(void);
+
+  void  SetCurrentState(const State &current);
+  void  SetExitPath(int chosenPencil,int path);
+  
+  const State &CurrentState(void)              const;
+  State        NextState(int chosenPencil)     const; 
+  State        AltNextState(int chosenPencil)  const;
+  BOOL         AltNextValidP(int chosenPencil) const;
+  int          ExitPath(int chosenPencil)      const;
+
+};
+
+// both are copied around by value, kept in tables and written to images as they
+// are, so they must stay plain data (no user-written copying or destruction)
+
+static_assert(std::is_trivially_copyable<State>::value,"State must be trivially copyable");
+static_assert(std::is_trivially_copyable<Transition>::value,"Transition must be trivially copyable");
+static_assert(sizeof(Transition)<=16,"Transition has grown beyond a state and its exit paths");
+
+std::ostream &operator<<(std::ostream &os,const Transition &t);
+
+// =================================================================================
+// Successors of a state as delivered to the search algorithms: either the index
+// of a state in the state space or one of the codes below. The successors of a
+// state always come in the order: pencil 0 next, pencil 0 alternate next (if
+// valid), pencil 1 next, pencil 1 alternate next (if valid), and so on for
+// further pencils.
+// =================================================================================
+
+typedef int StateIndex;
+
+const StateIndex SUCCESSOR_GOAL    = -1;
+const StateIndex SUCCESSOR_ILLEGAL = -2;
+const int        MAX_SUCCESSORS    = 2*MAX_PENCILS;
+
+// =================================================================================
+// Compact successor graph in compressed-sparse-row layout: the successors of
+// state 'i' are 'successors[Offset(i)]' up to (excluding)
+// 'successors[Offset(i+1)]'. This replaces the array of "Transition" (in which
+// the 'current' state is implied by the array index anyway and the alternate
+// states are nearly always unused).
+// A state space of 31-bit state indexes may well have more than 2^32 edges, so
+// the offsets are "EdgeOffset"s of 64 bits, but only one per OFFSET_BLOCK
+// states is stored ('bases'); every state stores the 32 bits by which its
+// offset exceeds the one of its block ('deltas'). A state takes 4 bytes plus
+// 4 per successor then, against the 16 bytes of a "Transition": with two
+// pencils (about two successors per state) the graph needs some three
+// quarters of the transition table, with three it is about as large, with
+// four (more than four successors per state) a third larger. Beyond that, the
+// graph keeps the successors of a state next to each other, ready to be used
+// without computing the next states, and it is what a "MazeImage" maps. The
+// successor array is held with malloc(), so that it grows and shrinks with
+// realloc() instead of being copied (which would need the old and the new
+// array at once).
+// =================================================================================
+// SuccessorGraph(long stateCount):
+//   create an empty graph for 'stateCount' states. States are then added in
+//   increasing index order with AddState(), each followed by its successors
+//   added with AddSuccessor(). Finally, Shrink() releases the unused capacity
+//   of the successor array.
+// SuccessorGraph(long stateCount,const EdgeOffset *offsets,
+//                StateIndex *successors):
+//   create a complete graph from the 'stateCount'+1 offsets of every state
+//   (they are only read) and 'successors', which must have been allocated with
+//   malloc() and is freed by the graph.
+// SuccessorGraph(long stateCount,EdgeOffset *bases,EdgeDelta *deltas,
+//                StateIndex *successors,BOOL owned):
+//   create a complete graph from the passed arrays. If 'owned', 'bases' and
+//   'deltas' must have been allocated with new[] and 'successors' with
+//   malloc(), and the graph releases them; otherwise they are just referred to
+//   (e.g. they are in a mapped "MazeImage") and must outlive the graph.
+// Successors(long index,const StateIndex *&first):
+//   set 'first' to the first successor of state 'index' and return the number
+//   of successors.
+// BaseCount(void):
+//   the number of entries of 'bases', StateCount()/OFFSET_BLOCK+1.
+// BaseArray(void),DeltaArray(void),SuccessorArray(void):
+//   the arrays themselves, to write them out ('deltas' has StateCount()+1
+//   entries).
+// Bytes(void):
+//   the memory used by the graph.
+// =================================================================================
+
+typedef unsigned long EdgeOffset;
+typedef unsigned int  EdgeDelta;
+
+const long OFFSET_BLOCK = 256;
+
+class SuccessorGraph {
+
+private:
+
+  long          stateCount;
+  long          addedStates;
+  EdgeOffset   *bases;       // stateCount/OFFSET_BLOCK+1 entries
+  EdgeDelta    *deltas;      // stateCount+1 entries
+  StateIndex   *successors;  // edgeCapacity entries, edgeCount used
+  EdgeOffset    edgeCount;
+  EdgeOffset    edgeCapacity;
+  BOOL          owned;
+
+  EdgeOffset Offset(long index) const;
+  void       SetOffset(long index,EdgeOffset offset);
+  void       Resize(EdgeOffset capacity);
+
+  // undefined and cannot be called
+
+  SuccessorGraph(const SuccessorGraph &old);
+  SuccessorGraph &operator=(const SuccessorGraph &old);
+
+public:
+
+  SuccessorGraph(long stateCount);
+  SuccessorGraph(long stateCount,const EdgeOffset *offsets,StateIndex *successors);
+  SuccessorGraph(long stateCount,EdgeOffset *bases,EdgeDelta *deltas,StateIndex *successors,BOOL owned);
+  ~SuccessorGraph(void);
+
+  void AddState(void);
+  void AddSuccessor(StateIndex x);
+  void Shrink(void);
+
+  int  Successors(long index,const StateIndex *&first) const;
+  long StateCount(void) const;
+  long EdgeCount(void)  const;
+  long Bytes(void)      const;
+  long BaseCount(void)  const;
+
+  const EdgeOffset *BaseArray(void)      const;
+  const EdgeDelta  *DeltaArray(void)     const;
+  const StateIndex *SuccessorArray(void) const;
+
+};
+
+// =================================================================================
+// The built-in maze solved at compile time: BUILTIN_TABLE holds the successors
+// of every state of the built-in maze (MAZE_RULES, two pencils, rule 60 as only
+// flag) and BUILTIN_SOLUTION the breadth-first search from the start state on
+// it, both computed by the compiler. The state indexes are those of "State"
+// for the built-in maze, and the rules are evaluated as Searcher::ExitPaths()
+// and Transition::NextState() do, with the successors in the same
+// order. The search expands the states in the same order as
+// Searcher::BfsTraverse() as well, so it picks the same shortest solution.
+//
+// BUILTIN_SOLUTION records, for every state, the depth at which it is reached
+// from the start state (0 if it is not reachable) and the state it is reached
+// from, and the shortest solution ('length' states in 'path', 0 if there is
+// none); unlike the run-time search, it goes on to the end, so 'depth' is the
+// reachability of the whole state space. The static_assert makes sure the
+// puzzle can be solved at all. BuiltinMazeP() tells whether a maze is the
+// built-in one. PrintBuiltinSolution() prints the solution as '-bfs' does,
+// without building any tables, if the installed maze is the built-in one
+// (FALSE otherwise); Searcher::CheckBuiltin() compares the run-time tables and
+// searches against these constants.
+// =================================================================================
+
+constexpr int  BUILTIN_PENCILS     = 2;
+constexpr int  BUILTIN_PENCIL_BITS = BitsNeeded(MAZEPOINT_COUNT);
+constexpr long BUILTIN_STATES      = 1L << (BUILTIN_PENCILS*BUILTIN_PENCIL_BITS+BUILTIN_PENCILS+1);
+
+struct BuiltinTable {
+  int        count[BUILTIN_STATES];
+  StateIndex succ[BUILTIN_STATES][MAX_SUCCESSORS];
+};
+
+struct BuiltinSolution {
+  int        depth[BUILTIN_STATES];
+  StateIndex parent[BUILTIN_STATES];
+  long       reached;
+  int        length;
+  StateIndex path[BUILTIN_STATES];
+};
+
+// the fields of a state index, laid out as in "State" (rule 60 is bit 0)
+constexpr int BuiltinShift(int pencil) {
+  return 1+(BUILTIN_PENCILS-1-pencil)*BUILTIN_PENCIL_BITS;
+}
+
+constexpr long BuiltinMovedBit(int pencil) {
+  return 1L << (1+BUILTIN_PENCILS*BUILTIN_PENCIL_BITS+BUILTIN_PENCILS-1-pencil);
+}
+
+constexpr int BuiltinBox(long index,int pencil) {
+  return (int)((index>>BuiltinShift(pencil)) & ((1L<<BUILTIN_PENCIL_BITS)-1));
+}
+
+constexpr long BuiltinStartIndex(void) {
+  return ((long)MAZEPOINT_INDEX.index[START_PENCIL_0] << BuiltinShift(0)) |
+         ((long)MAZEPOINT_INDEX.index[START_PENCIL_1] << BuiltinShift(1));
+}
+
+constexpr unsigned BuiltinProperties(int box) {
+  return MAZE_RULES[box].properties |
+         ((MAZE_RULES[box].number%2==1) ? PROP_ODD_NUMBER : 0) |
+         ((MAZE_RULES[box].number%5==0) ? PROP_MULTIPLE_OF_FIVE : 0);
+}
+
+constexpr bool BuiltinIgnoredP(long index,int box) {
+  return (index & 1) && (BuiltinProperties(box) & PROP_RED_TEXT);
+}
+
+// the exit path of 'pencil' without the counterfactual rule, see
+// Searcher::DirectExitPath()
+constexpr int BuiltinDirectExitPath(long index,int pencil) {
+  int            other = (pencil+1)%BUILTIN_PENCILS;
+  int            self  = BuiltinBox(index,pencil);
+  const BoxRule &rule  = MAZE_RULES[self];
+  if (BuiltinIgnoredP(index,self)) return PATH_YES;
+  switch (rule.kind) {
+  case RULE_OTHER_HAS:   return (BuiltinProperties(BuiltinBox(index,other)) & rule.mask) ? PATH_YES : PATH_NO;
+  case RULE_SELF_HAS:    return (BuiltinProperties(self) & rule.mask) ? PATH_YES : PATH_NO;
+  case RULE_OTHER_MOVED: return (index & BuiltinMovedBit(other)) ? PATH_YES : PATH_NO;
+  case RULE_CHOICE:      return PATH_LUGNUT;
+  case RULE_ALWAYS:      return PATH_YES;
+  case RULE_FLAG_SET:    return (index & 1) ? PATH_YES : PATH_NO;
+  default:               return PATH_NONE;
+  }
+}
+
+// the exit path of 'pencil', following the counterfactual rules as
+// Searcher::ExitPaths() does
+constexpr int BuiltinExitPath(long index,int pencil) {
+  bool counterfactual[BUILTIN_PENCILS] = {};
+  for (int p=0;p<BUILTIN_PENCILS;p++) {
+    int box = BuiltinBox(index,p);
+    counterfactual[p] = MAZE_RULES[box].kind==RULE_COUNTERFACTUAL && !BuiltinIgnoredP(index,box);
+  }
+  if (!counterfactual[pencil]) return BuiltinDirectExitPath(index,pencil);
+  int  other  = (pencil+1)%BUILTIN_PENCILS;
+  bool invert = true;
+  while (other!=pencil && counterfactual[other]) {
+    other  = (other+1)%BUILTIN_PENCILS;
+    invert = !invert;
+  }
+  if (other==pencil) return PATH_NONE;
+  bool no = BuiltinDirectExitPath(index,other)==PATH_NO;
+  return (no==invert) ? PATH_YES : PATH_NO;
+}
+
+// the successor of state 'index' if 'pencil' is moved to the box numbered
+// 'target' (see Transition::NextState())
+constexpr StateIndex BuiltinSuccessor(long index,int pencil,int target) {
+  int            other = (pencil+1)%BUILTIN_PENCILS;
+  const BoxRule &rule  = MAZE_RULES[BuiltinBox(index,pencil)];
+  long           next  = index;
+  bool           goal  = false;
+  for (int p=0;p<BUILTIN_PENCILS;p++) next &= ~BuiltinMovedBit(p);
+  if (target==GOAL_MAZEPOINT) goal = true;
+  else {
+    next &= ~(((1L<<BUILTIN_PENCIL_BITS)-1) << BuiltinShift(pencil));
+    next |= (long)MAZEPOINT_INDEX.index[target] << BuiltinShift(pencil);
+  }
+  next |= BuiltinMovedBit(pencil);
+  if (!BuiltinIgnoredP(index,BuiltinBox(index,pencil))) {
+    if (rule.effects & (EFFECT_SET_RULE60|EFFECT_SET_FLAG))     next |= 1;
+    if (rule.effects & (EFFECT_CLEAR_RULE60|EFFECT_CLEAR_FLAG)) next &= ~1L;
+    if (rule.effects & EFFECT_MOVE_OTHER) {
+      int otherTarget = MAZE_RULES[BuiltinBox(index,other)].yes;
+      if (otherTarget==GOAL_MAZEPOINT) goal = true;
+      else {
+        next &= ~(((1L<<BUILTIN_PENCIL_BITS)-1) << BuiltinShift(other));
+        next |= (long)MAZEPOINT_INDEX.index[otherTarget] << BuiltinShift(other);
+      }
+      next |= BuiltinMovedBit(other);
+    }
+  }
+  return goal ? SUCCESSOR_GOAL : (StateIndex)next;
+}
+
+constexpr BuiltinTable MakeBuiltinTable(void) {
+  BuiltinTable result = {};
+  for (long index=0;index<BUILTIN_STATES;index++) {
+    int count = 0;
+    for (int p=0;p<BUILTIN_PENCILS;p++) {
+      const BoxRule &rule = MAZE_RULES[BuiltinBox(index,p)];
+      int            path = BuiltinExitPath(index,p);
+      if (path==PATH_NONE) {
+        // deadly embrace
+        result.succ[index][count++] = SUCCESSOR_ILLEGAL;
+        continue;
+      }
+      result.succ[index][count++] = BuiltinSuccessor(index,p,(path==PATH_NO) ? rule.no : rule.yes);
+      if (path==PATH_LUGNUT) result.succ[index][count++] = BuiltinSuccessor(index,p,rule.no);
+    }
+    result.count[index] = count;
+  }
+  return result;
+}
+
+constexpr BuiltinSolution SolveBuiltin(const BuiltinTable &table) {
+  BuiltinSolution result = {};
+  StateIndex      queue[BUILTIN_STATES] = {};
+  long            head  = 0;
+  long            tail  = 0;
+  long            last  = -1;
+  long            start = BuiltinStartIndex();
+  result.depth[start]  = 1;
+  result.parent[start] = -1;
+  queue[tail++]        = (StateIndex)start;
+  while (head<tail) {
+    long index = queue[head++];
+    for (int i=0;i<table.count[index];i++) {
+      StateIndex next = table.succ[index][i];
+      if (next==SUCCESSOR_GOAL && last<0) last = index;
+      if (next<0 || result.depth[next]>0) continue;
+      result.depth[next]  = result.depth[index]+1;
+      result.parent[next] = (StateIndex)index;
+      queue[tail++]       = next;
+    }
+  }
+  result.reached = tail;
+  if (last>=0) {
+    result.length = result.depth[last];
+    for (int i=result.length-1;i>=0;i--) {
+      result.path[i] = (StateIndex)last;
+      last           = result.parent[last];
+    }
+  }
+  return result;
+}
+
+constexpr BuiltinTable    BUILTIN_TABLE    = MakeBuiltinTable();
+constexpr BuiltinSolution BUILTIN_SOLUTION = SolveBuiltin(BUILTIN_TABLE);
+
+static_assert(BUILTIN_SOLUTION.length>0,"the built-in maze cannot be solved");
+
+BOOL BuiltinMazeP(const Maze &maze);
+BOOL PrintBuiltinSolution(std::ostream &os);
+
+// =================================================================================
+// A maze compiled to a binary image: the maze's rules and its successor graph,
+// written by Searcher::WriteImage() and mapped into memory read-only by Open(),
+// so that searching a large maze again needs no parsing and no building of the
+// transitions. The file is a "MazeImageHeader" followed by the sections it
+// points to, each at a multiple of 8 bytes:
+//
+//   rules       'boxCount' "BoxRule"s, in box index order
+//   bases       'stateCount'/OFFSET_BLOCK+1 "EdgeOffset"s of the successor graph
+//   deltas      'stateCount'+1 "EdgeDelta"s of the successor graph
+//   successors  'edgeCount' "StateIndex"es of the successor graph
+//
+// The image is meant to be read on the machine that wrote it: the byte order
+// and the type sizes are checked, not converted. Open() does not trust the
+// file: the counts in the header must not be negative, every section must be
+// aligned and lie inside the file, the offsets (block base plus state delta)
+// must run from 0 up to 'edgeCount' without ever decreasing, and every
+// successor must be a state index below 'stateCount' or one of the successor
+// codes. An image that fails a check is unmapped again.
+// =================================================================================
+// Open(const char *fileName,std::ostream &err):
+//   map image 'fileName'. On errors, a message is written to 'err' and FALSE
+//   returned.
+// GetMaze(void):
+//   the maze of the image.
+// NewGraph(void):
+//   a new successor graph referring to the mapped arrays; it must be deleted
+//   before the image is.
+// Symmetric(void):
+//   was the graph built with symmetric pencils (see "Searcher")?
+// =================================================================================
+
+const char         MAZE_IMAGE_MAGIC[8]   = "COWSIMG";
+const unsigned int MAZE_IMAGE_VERSION    = 5;
+const unsigned int MAZE_IMAGE_BYTE_ORDER = 0x01020304;
+
+struct MazeImageHeader {
+  char          magic[8];
+  unsigned int  version;
+  unsigned int  byteOrder;
+  unsigned int  sizes;          // sizeof BoxRule, StateIndex and long, a byte each
+  int           boxCount;
+  int           pencilCount;
+  int           flagCount;
+  int           start[MAX_PENCILS];
+  int           indexBits;
+  int           symmetric;      // only canonical states have successors
+  long          stateCount;
+  long          edgeCount;
+  long          rulesOffset;
+  long          basesOffset;
+  long          deltasOffset;
+  long          successorsOffset;
+  long          fileSize;
+};
+
+class MazeImage {
+
+private:
+
+  void  *base;
+  long   size;
+  Maze  *maze;
+
+  static unsigned int Sizes(void);
+
+  BOOL Check(const char *fileName,std::ostream &err);
+  void Close(void);
+
+  // undefined and cannot be called
+
+  MazeImage(const MazeImage &old);
+  MazeImage &operator=(const MazeImage &old);
+
+public:
+
+  MazeImage(void);
+  ~MazeImage(void);
+
+  BOOL            Open(const char *fileName,std::ostream &err);
+  const Maze     &GetMaze(void)   const;
+  SuccessorGraph *NewGraph(void)  const;
+  BOOL            Symmetric(void) const;
+
+  static BOOL Write(const char *fileName,const Maze &maze,const SuccessorGraph &graph,
+                    BOOL symmetric,std::ostream &err);
+
+};
+
+// =================================================================================
+// Split the range [from,to) into 'threads' contiguous chunks and call
+// 'work(chunkFrom,chunkTo,chunk)' for each of them, each on its own thread. The
+// calling thread takes the first chunk and waits for the others to finish. With
+// 'threads' <= 1 this is just a call of 'work(from,to,0)'.
+// =================================================================================
+
+template <class F> void ParallelFor(long from,long to,int threads,F work) {
+  if (threads<=1 || to-from<2) {
+    work(from,to,0);
+    return;
+  }
+  long         chunk   = (to-from+threads-1)/threads;
+  std::thread *workers = new std::thread[threads];
+  for (int t=1;t<threads;t++) {
+    long chunkFrom = from+t*chunk;
+    long chunkTo   = chunkFrom+chunk;
+    if (chunkFrom>to) chunkFrom=to;
+    if (chunkTo>to)   chunkTo=to;
+    workers[t] = std::thread(work,chunkFrom,chunkTo,t);
+  }
+  work(from,(from+chunk<to) ? from+chunk : to,0);
+  for (int t=1;t<threads;t++) {
+    workers[t].join();
+  }
+  delete[] workers;
+}
+
+// =================================================================================
+// How the "Searcher" holds the transitions
+// =================================================================================
+
+const int TABLE_DENSE   = 0; // one "Transition" per state, computed up front
+const int TABLE_COMPACT = 1; // "SuccessorGraph", computed up front
+const int TABLE_LAZY    = 2; // "Transition" computed on first use, kept in pages
+
+// =================================================================================
+// Formats of the dump of the visited transitions (see Searcher::DumpTransitions())
+// =================================================================================
+
+const int DUMP_PRETTY = 0; // "Transition" or successor list printed by operator<<
+const int DUMP_CSV    = 1; // one line of comma-separated values per state
+const int DUMP_BINARY = 2; // one "DumpRecord" per state
+const int DUMP_NONE   = 3; // no dump
+
+// =================================================================================
+// A state in the binary dump: its index, its 'visited' value and its successors
+// (see "StateIndex", 'count' entries are used). Written in the byte order of the
+// machine.
+// =================================================================================
+
+struct DumpRecord {
+  StateIndex index;
+  int        visited;
+  int        count;
+  StateIndex successors[MAX_SUCCESSORS];
+};
+
+// the dumps are collected in memory and written in pieces of this size
+const long DUMP_BUFFER_SIZE = 1L << 20;
+
+// =================================================================================
+// Search statistics, compiled in only if COWS_STATS is defined (g++ -DCOWS_STATS
+// ...). The counting is done through STATS(...), which expands to nothing
+// otherwise, so a build without COWS_STATS does not pay for it at all. The
+// depth-first and breadth-first searches (including Solve() and the parallel
+// one) count:
+//
+//   expanded     states whose successors were generated
+//   reexpanded   depth-first search: states entered again because they were
+//                reached at a smaller depth than before (each is also counted
+//                as expanded)
+//   duplicates   successors not entered because they had been visited already
+//   goalHits     successors that are goal states
+//   illegalHits  successors that are illegal states
+//   frontier     breadth-first search: the number of states per level
+//
+// and the searcher measures the time spent in its phases: building the
+// tables, searching and dumping. All figures add up over the searches run.
+// A progress line is written to std::cerr every STATS_PROGRESS expansions.
+// WriteJson() writes them as a JSON object.
+// =================================================================================
+
+#ifdef COWS_STATS
+
+#define STATS(statement) statement
+
+const long STATS_PROGRESS = 1L << 22;
+
+struct SearchStats {
+  long              expanded;
+  long              reexpanded;
+  long              duplicates;
+  long              goalHits;
+  long              illegalHits;
+  std::vector<long> frontier;
+  double            buildSeconds;
+  double            searchSeconds;
+  double            dumpSeconds;
+
+  SearchStats(void);
+  void Expanded(int depth);
+  void Level(int depth,long states);
+  void WriteJson(std::ostream &os) const;
+};
+
+// adds the time from its construction to its destruction to 'seconds'
+class StatsTimer {
+  double                                &seconds;
+  std::chrono::steady_clock::time_point  begin;
+public:
+  StatsTimer(double &secondsIn) : seconds(secondsIn),begin(std::chrono::steady_clock::now()) {}
+  ~StatsTimer(void) {
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+  }
+};
+
+#else
+
+#define STATS(statement)
+
+#endif
+
+// =================================================================================
+// A page of the lazily computed state space: LAZY_PAGE_SIZE consecutive states
+// with their transitions (valid only where the 'computed' flag is set), their
+// search columns and their marks of Searcher::Prune() (see "Searcher"). A page
+// is only allocated once a state in it is touched, so memory scales with the
+// number of states reached.
+// =================================================================================
+
+const int  LAZY_PAGE_BITS = 8;
+const long LAZY_PAGE_SIZE = 1L << LAZY_PAGE_BITS;
+
+struct LazyPage {
+  Transition    trs[LAZY_PAGE_SIZE];
+  int           visited[LAZY_PAGE_SIZE];
+  StateIndex    parent[LAZY_PAGE_SIZE];
+  unsigned char computed[LAZY_PAGE_SIZE];
+  unsigned char liveness[LAZY_PAGE_SIZE];
+};
+
+// =================================================================================
+// The search columns of a query of the solver service (see
+// Searcher::StartService()): a 'visited' column over the whole state space,
+// cleared in O(1) by Reset() with the same epoch trick as the one of the
+// searcher, and the queue of the breadth-first search. Every worker thread
+// that gets a query keeps its own arena for all its queries, so the queries
+// share nothing but the read-only tables and no memory is allocated per query
+// once the queue has grown to its largest size.
+// =================================================================================
+
+class SearchArena {
+
+  long                    states;
+  int                    *visited;
+  int                     visitedBase;
+  int                     visitedTop;
+  std::vector<StateIndex> queue;
+
+  // no copies
+  SearchArena(const SearchArena &old);
+  SearchArena &operator=(const SearchArena &old);
+
+public:
+
+  SearchArena(long states);
+  ~SearchArena(void);
+
+  void                     Reset(void);
+  int                      Visited(long index) const;
+  void                     SetVisited(long index,int depth);
+  std::vector<StateIndex> &Queue(void) { return queue; }
+};
+
+// =================================================================================
+// The state space searcher. Depending on the table mode, the transitions are
+// held in 'space', one "Transition" per state (TABLE_DENSE), in the successor
+// graph 'graph' (TABLE_COMPACT) or in the sparse page table 'pages'
+// (TABLE_LAZY), in which a transition is computed when its successors are first
+// asked for. The tables computed up front are computed by 'threads' threads;
+// as every transition only depends on its own current state, the result is the
+// same as with a single thread. The breadth-first search also uses 'threads'
+// threads, except for TABLE_LAZY, where computing a transition on first use is
+// not thread-safe. Search algorithms go through GetSuccessors() and do not care which
+// one is used. What the search algorithms find out about a state is kept in
+// separate columns indexed by state index (in the pages for TABLE_LAZY), reached
+// through Visited(), Parent() and their setters:
+//
+//   visited: depth at which the state was visited (0 if not visited)
+//   parent:  index of the state from which the state was reached (-1 for the
+//            start state); the paths printed are reconstructed from it
+//
+// The tables are built once, and any number of searches can be run on them.
+// Every search starts with Reset(), which forgets the previous one in O(1):
+// the 'visited' column holds depths plus 'visitedBase', and values up to
+// 'visitedBase' count as 0, so raising 'visitedBase' to the highest value
+// stored so far ('visitedTop') clears it. Only when the values get near to
+// INT_MAX is the column actually cleared. 'parent' need not be cleared, it is
+// only read for visited states. Solve() finds a shortest solution from any
+// start state; 'origin' is the start state of the latest search.
+//
+// Searches that go backwards from the goal use the reverse successor graph
+// 'reverse' (the predecessors of every state) and the list 'preGoal' of the
+// states that have a goal state as successor. Both are built on first use by
+// BuildReverseGraph(), once per searcher and for all the searches after.
+//
+// Prune() marks the states that are of no use to a search from the start
+// state: those it cannot reach and those from which the goal cannot be reached
+// (such as the states that only lead into the 26/26 "deadly embrace"). From
+// then on GetSuccessors() leaves out the pruned and the illegal successors, so
+// no search expands a pruned state, and an illegal successor no longer cuts
+// off its siblings in the depth-first search. AllSuccessors() still gives every
+// successor; the dumps and the reverse graph are built from it. The marks are
+// the LIVE_... bits in 'liveness' (in the pages for TABLE_LAZY, so that only
+// the pages of the states reached hold them); 'pruned' tells whether Prune()
+// has been run. For a search from another start state (see
+// SetOrigin()) only the states known to be dead are left out: those reached
+// from the start state of Prune() that cannot reach the goal.
+//
+// StartAStarTraversal() is an A* search toward the goal. Its heuristic is
+// the fewest moves any single pencil needs to reach a box with an exit to the
+// goal (box 50 in the puzzle), along the Yes and No exits of the boxes and
+// regardless of the rules ('boxDistance', by box index, computed once by
+// BoxDistances(); INT_MAX where no such box can be reached). A move takes
+// every pencil at most one exit further (the moved pencil, and the other one
+// with EFFECT_MOVE_OTHER), so the heuristic never overestimates and drops by
+// at most 1 per move (it is consistent); the first state with a goal
+// successor taken off the queue therefore ends a shortest solution.
+//
+// StartService() answers queries read from a stream on the tables built, any
+// number of them at once (see "SearchArena"): SolveShared() is a breadth-first
+// search that only reads the tables and keeps its columns in an arena, so it
+// may run on several threads at the same time. It gives the depth only, and
+// leaves out the pruned states of Prune() only as far as they are dead. The
+// transitions of TABLE_LAZY are computed on first use, so it cannot be shared.
+// StartListening() serves the same queries over TCP, each connection on a
+// thread of its own, all of them searching the same tables at once.
+//
+// For state spaces that do not fit in memory, StartLeanSearch() runs the
+// breadth-first search of "LeanSearch", which keeps no table: with TABLE_LAZY,
+// FreshSuccessors() computes every transition when needed without storing it.
+//
+// When the rule of a box has been changed (see Maze::Edit()), Edit() brings the
+// tables up to date: a transition only depends on the rules and properties of
+// the boxes its pencils are at, so only the states with a pencil at the box are
+// recomputed (for TABLE_LAZY, they are just marked as not computed). The latest
+// search still holds if none of those states was visited before the level of
+// its solution (or, without a solution, at all) and the last state of the
+// solution is not among them: the levels up to the solution are then the same.
+// The successor graph of TABLE_COMPACT cannot be edited.
+//
+// The successor graph may also be passed in ready-made (from a "MazeImage"); the
+// searcher then works with TABLE_COMPACT. WriteImage() writes the maze with the
+// successor graph as image (TABLE_COMPACT only).
+//
+// If 'symmetric' is set, states that only differ by a rotation of the pencils
+// (pencil p taking the place of pencil p+1, the last one that of pencil 0, with
+// their movement flags) are identified. A rotation maps the rules of "the other
+// pencil" onto themselves, so such states have the same future. Only the
+// canonical state of every class (the one with the smallest index, see
+// CanonicalIndex()) is computed and searched; successors are canonicalized when
+// they are indexed. With two pencils this merges (7,1) and (1,7), halving the
+// state space (with K pencils it is a reduction by a factor of K). The paths
+// printed are mapped back to concrete pencil identities by ConcretePath().
+// =================================================================================
+
+const unsigned char LIVE_REACHED = 1u<<0; // reached from the start state
+const unsigned char LIVE_TO_GOAL = 1u<<1; // the goal can be reached from it
+
+const int TRACE_DEPTH = 37; // the longest path StartTraversal() prints by default
+
+class Searcher {
+
+  int             tableMode;
+  int             threads;
+  BOOL            symmetric;
+  Transition     *space;
+  SuccessorGraph *graph;
+  LazyPage      **pages;
+  long            pageCount;
+  long            pagesAllocated;
+  long            lazyComputed;
+  int            *visited;
+  StateIndex     *parent;
+  SuccessorGraph *reverse;
+  StateIndex     *preGoal;
+  long            preGoalCount;
+  int             visitedBase;
+  int             visitedTop;
+  State           origin;
+  long            solution;
+  unsigned char  *liveness;
+  BOOL            pruned;
+  long            pruneStart;
+  BOOL            pruneAll;
+  int             traceDepth;
+  int            *boxDistance;
+#ifdef COWS_STATS
+  SearchStats     stats;
+#endif
+
+  static long TotalStates(void);
+  static long ComputeIndex(const State &current);
+
+  void EnumerateTransitions(void);
+  void BuildSuccessorGraph(void);
+  void ComputeTransition(long index,Transition &trs);
+  void ComputeTransitionRow(long row,const unsigned char *lastPaths,unsigned long long *scratch,
+                            Transition *trs) const;
+
+  int  TransitionSuccessors(const Transition &trs,StateIndex *succ) const;
+  int  SharedSuccessors(long index,StateIndex *succ) const;
+  long CanonicalIndex(const State &s) const;
+  BOOL ListedP(long index) const;
+  void ConcretePath(State *path,int length);
+
+  LazyPage         &Page(long index);
+  const Transition &TransitionAt(long index);
+  int               AllSuccessors(long index,StateIndex *succ);
+  int               FreshSuccessors(long index,StateIndex *succ);
+  int               GetSuccessors(long index,StateIndex *succ);
+  unsigned char     Liveness(long index) const;
+  BOOL              PrunedP(long index) const;
+  void              SetOrigin(const State &start);
+
+  int        Visited(long index) const;
+  void       SetVisited(long index,int depth);
+  StateIndex Parent(long index) const;
+  void       SetParent(long index,StateIndex p);
+
+  void RecTraverse(long index,StateIndex from,int depth,int &maxDepth);
+  long ShortestSearch(const State &start,int &maxDepth);
+  long BfsTraverse(long startIndex,int &maxDepth);
+  long ParallelBfsTraverse(long startIndex,int &maxDepth);
+  int  BidirectionalTraverse(long startIndex,std::vector<StateIndex> &path);
+  long AStarTraverse(long startIndex,long &expanded);
+  void BoxDistances(void);
+  int  Heuristic(long index) const;
+
+  void DumpPretty(std::ostream &os);
+  void DumpPath(long index,const char *title,std::ostream &os);
+  void PrintPath(const StateIndex *path,int length,const char *title,std::ostream &os);
+
+  static int   DirectExitPath(int chosenPencil,const State &current);
+  static void  ExitPaths(Transition &trs);
+  static void  ResolveCounterfactuals(const BOOL *counterfactual,unsigned char *paths);
+  static long  RowLength(void);
+  static unsigned char *LastPencilPaths(void);
+  static unsigned long long *RowScratch(void);
+  static int   OtherPencil(int pencil);
+  static State StartState(void);
+  static BOOL  ParseStart(const std::string &line,State &start);
+  void         ServeQueries(std::istream &is,std::ostream &os,int workers) const;
+  
+  // undefined and cannot be called
+
+  Searcher(const Searcher &old);
+  Searcher &operator=(const Searcher &old);
+
+  friend class ShortestSolutions;
+  friend class Condensation;
+  friend class LeanSearch;
+
+public:
+
+  Searcher(int tableMode = TABLE_DENSE,int threads = 1,BOOL symmetric = FALSE);
+  Searcher(SuccessorGraph *graph,int threads = 1,BOOL symmetric = FALSE);
+  ~Searcher(void);
+
+  BOOL WriteImage(const char *fileName);
+  void BuildReverseGraph(void);
+
+  void Reset(void);
+  void Prune(void);
+  int  Solve(const State &start);
+  int  SolveShared(SearchArena &arena,const State &start) const;
+  void PrintSolution(std::ostream &os);
+
+  void StartTraversal(BOOL allTraces = FALSE);
+  void StartBfsTraversal(void);
+  void StartBidirectionalTraversal(void);
+  void StartAStarTraversal(void);
+  void StartAllPairsSweep(void);
+  void StartCounting(long listLimit);
+  BOOL StartQueries(const char *fileName);
+  BOOL StartService(std::istream &is,std::ostream &os);
+  BOOL StartListening(const char *address);
+  BOOL CheckBuiltin(void);
+  void StartCondensation(void);
+  long Edit(int box,BOOL &kept);
+  BOOL StartEditing(Maze &maze,const char *fileName);
+  BOOL StartLeanSearch(int visitedMode,const char *spillDirectory);
+  long TableBytes(void) const;
+  long VisitedCount(void) const;
+#ifdef COWS_STATS
+  const SearchStats &Stats(void) const { return stats; }
+#endif
+  void DumpTransitions(std::ostream &os,int format = DUMP_PRETTY);
+};
+
+// =================================================================================
+// The shortest solutions of the maze
+// =================================================================================
+// The constructor runs a breadth-first search from 'startIndex' (in the
+// 'visited' and 'parent' columns of the searcher, which must be Reset()) to the
+// end of the level at which the goal is first reached, and adds up, for every
+// state, the number of shortest paths from the start to it: a state of depth
+// d+1 gets the sum of the counts of its predecessors of depth d. Length() is the
+// number of states of a shortest solution (0 if the goal cannot be reached),
+// Count() the number of distinct shortest solutions, as sequences of states
+// from the start state to a state with a goal state as successor. A count that
+// does not fit into an unsigned long sticks at ULONG_MAX (Saturated()). With a
+// symmetric searcher, sequences of canonical states are counted.
+//
+// A pass back over the levels then marks the states of the shortest solutions,
+// those from which the goal is reached in the remaining number of moves.
+// Next() walks the marked states depth-first, keeping one successor position
+// per level, and fills in the next solution (Length() state indices), or
+// returns FALSE when there are no more. The solutions are thus produced one at
+// a time, however many there are; memory is a count and a mark per state.
+// =================================================================================
+
+class ShortestSolutions {
+
+  Searcher      &searcher;
+  long           startIndex;
+  int            length;
+  unsigned long  count;
+  BOOL           saturated;
+  unsigned long *pathCount;
+  char          *onPath;
+  BOOL           started;
+  StateIndex    *path;
+  StateIndex    *candidates;
+  int           *candidateCount;
+  int           *cursor;
+
+  int  LevelSuccessors(long index,StateIndex *succ,BOOL &goal);
+  void Descend(int level);
+
+  // no copies
+  ShortestSolutions(const ShortestSolutions &old);
+  ShortestSolutions &operator=(const ShortestSolutions &old);
+
+public:
+
+  ShortestSolutions(Searcher &searcher,long startIndex);
+  ~ShortestSolutions(void);
+
+  int           Length(void) const { return length; }
+  unsigned long Count(void) const { return count; }
+  BOOL          Saturated(void) const { return saturated; }
+  BOOL          Next(StateIndex *solution);
+};
+
+// =================================================================================
+// The condensation of the state graph
+// =================================================================================
+// The maze is full of cycles (1 -> 2 -> 7 -> 26 -> 61 -> 1 among them). The
+// constructor determines the strongly connected components of the successor
+// graph of all (listed) states with Tarjan's algorithm, run iteratively with an
+// explicit stack of (state, successor position) frames, so that long paths do
+// not exhaust the call stack. Tarjan finishes every component after all
+// components it leads to, so numbering them in that order numbers the
+// condensed graph topologically: the successors of component c all have
+// numbers below c. The condensed graph 'dag' is built as the components are
+// finished, a component's successors being known by then, and so is whether
+// the goal can be reached from it ('toGoal'). 'members' holds the states of
+// every component, both in a "SuccessorGraph" with a node per component.
+//
+// A loop trap is a component in which the pencils can go round in circles: more
+// than one state, or a state that is its own successor. ReachesGoalP() tells in
+// O(1) whether the goal can be reached from a state, Reachable() marks the
+// components reached from a state in one pass down the topological order.
+// =================================================================================
+
+const int SCC_LIST_LIMIT = 8; // states printed per loop trap
+
+class Condensation {
+
+  long            componentCount;
+  StateIndex     *component;  // per state, -1 if not listed
+  SuccessorGraph *dag;
+  SuccessorGraph *members;
+  char           *toGoal;     // per component
+  char           *loop;       // per component
+
+  // no copies
+  Condensation(const Condensation &old);
+  Condensation &operator=(const Condensation &old);
+
+public:
+
+  Condensation(Searcher &searcher);
+  ~Condensation(void);
+
+  long Components(void) const { return componentCount; }
+  long Component(long index) const { return component[index]; }
+  BOOL LoopP(long c) const { return loop[c]; }
+  BOOL ReachesGoalP(long index) const { return component[index]>=0 && toGoal[component[index]]; }
+  int  Members(long c,const StateIndex *&first) const { return members->Successors(c,first); }
+  void Reachable(long index,char *reached) const;
+};
+
+// =================================================================================
+// Breadth-first search for state spaces that do not fit in memory
+// =================================================================================
+// The search keeps no 'visited' and 'parent' columns, only a visited set in
+// one of these forms ('mode'):
+//
+//   VISITED_BITS    a bit per state, the current and the next level as lists
+//                   of state indexes in memory
+//   VISITED_LAYERS  two bits per state and no lists: every state is unseen,
+//                   closed, or on the current or the next level (the codes of
+//                   these two swap from level to level), and every level is
+//                   a sweep over all states for those on the current level
+//   VISITED_DISK    the levels are sorted files in directory 'spillDirectory'.
+//                   The successors of a level are collected in memory up to
+//                   DISK_BUFFER states, sorted and written as runs; the runs are
+//                   then merged, and the states seen before are removed in the
+//                   same pass over the sorted file of all states seen so far
+//                   (delayed duplicate detection). All levels are needed for
+//                   this, as the graph is directed.
+//   VISITED_AUTO    the first of these whose memory (see ModeBytes()) fits in
+//                   the memory available (the free physical memory, or the
+//                   address space limit if lower)
+//
+// Run() returns the number of states of a shortest solution from 'startIndex'
+// (0 if there is none), like Searcher::Solve(), or -1 if the directory or a file
+// of VISITED_DISK cannot be created, written or read (after a message naming
+// it). The bit sets and the codes only tell whether a state has been seen, not
+// how, so only VISITED_DISK gives the solution itself: it is traced back through
+// the level files, from the last state to a predecessor on the level before, and
+// so on. The others give its last state, Last().
+// =================================================================================
+
+const int VISITED_AUTO   = 0;
+const int VISITED_BITS   = 1;
+const int VISITED_LAYERS = 2;
+const int VISITED_DISK   = 3;
+
+const long DISK_BUFFER         = 1L << 22; // states sorted in memory per run
+const int  LEAN_FRONTIER_SHARE = 16;       // a level is assumed to hold at most 1/16 of the states
+
+class LeanSearch {
+
+  Searcher               &searcher;
+  int                     mode;
+  std::string             directory;
+  std::vector<std::string> files;
+  long                    last;
+  long                    reached;
+  long                    widest;
+  long                    spilled;
+  StateIndex             *path;
+
+  int  BitsSearch(long startIndex);
+  int  LayersSearch(long startIndex);
+  int  DiskSearch(long startIndex);
+  BOOL TracePath(int length);
+
+  std::string NewFile(const char *kind,int number);
+  BOOL        WriteRun(std::vector<StateIndex> &buffer);
+
+  // no copies
+  LeanSearch(const LeanSearch &old);
+  LeanSearch &operator=(const LeanSearch &old);
+
+public:
+
+  LeanSearch(Searcher &searcher,int mode,const char *spillDirectory);
+  ~LeanSearch(void);
+
+  static long ModeBytes(int mode);
+  static long AvailableBytes(void);
+
+  int               Run(long startIndex);
+  int               Mode(void) const    { return mode; }
+  long              Last(void) const    { return last; }
+  long              Reached(void) const { return reached; }
+  long              Widest(void) const  { return widest; }
+  long              Spilled(void) const { return spilled; }
+  const StateIndex *Path(void) const    { return path; }
+};
+
+// =================================================================================
+// Benchmarks
+// =================================================================================
+// RunBenchmarks() times the table builds and the search engines on the built-in
+// maze and on chained copies of it (see Maze::Chain()) of about 100, 1000 and
+// 10000 boxes, and on generated mazes (see Maze::Generate(), with branching
+// BENCH_BRANCHING and seed BENCH_SEED) of 16 to 10000 boxes, each with 2, 3
+// and 4 pencils (p in the maze column), and prints a line per maze and
+// engine: the time, the time per state and the states per second (of the whole
+// state space for the builds, of the states visited for the searches), the
+// peak resident set size and the table bytes per state of the state space. The
+// lazy search is timed with its table, the other searches without (the
+// bidirectional one without its reverse graph either).
+//
+// Every measurement runs in a child process of its own, so that the peak RSS
+// is its own, and a run that crashes (the depth-first search may run out of
+// stack on large mazes) or takes longer than BENCH_TIMEOUT seconds is reported
+// as such. Mazes whose states do not fit into a state index are skipped, and
+// so are the dense and compact tables where they would take more than
+// BENCH_MEMORY_LIMIT bytes; a child may take 4*BENCH_MEMORY_LIMIT bytes of
+// address space, beyond that the run is reported as out of memory. 'threads'
+// is the number of threads of the parallel runs.
+// =================================================================================
+
+const int  BENCH_TIMEOUT      = 30;
+const int  BENCH_BRANCHING    = 70;
+const long BENCH_SEED         = 1;
+const long BENCH_MEMORY_LIMIT = 1L << 30;
+
+void RunBenchmarks(int threads);
+
+// =================================================================================
+// Inline definitions for "Maze", "State", "Transition" and "SuccessorGraph"
+// =================================================================================
+
+inline int Maze::BoxCount(void) const {
+  return boxCount;
+}
+
+inline int Maze::Number(int i) const {
+  assert(0<=i && i<boxCount);
+  return rules[i].number;
+}
+
+inline int Maze::Index(int number) const {
+#ifndef NDEBUG
+  if (number<0 || maxNumber<number || index[number]<0) {
+    std::cerr << "Maze::Index(): No such maze point: " << number << std::endl << std::flush;
+    abort();
+  }
+#endif
+  return index[number];
+}
+
+inline BOOL Maze::BoxP(int number) const {
+  return 0<=number && number<=maxNumber && index[number]>=0;
+}
+
+inline BOOL Maze::OtherYesP(int self,int other) const {
+  assert(0<=self && self<boxCount && 0<=other && other<boxCount);
+  return (otherYes[(long)self*yesWords+(other>>6)]>>(other&63)) & 1;
+}
+
+inline const unsigned long long *Maze::OtherYesColumn(int self) const {
+  assert(0<=self && self<boxCount);
+  return otherYes+(long)self*yesWords;
+}
+
+inline const unsigned *Maze::OtherHasMasks(void) const {
+  return otherMask;
+}
+
+inline const BoxRule &Maze::Rule(int i) const {
+  assert(0<=i && i<boxCount);
+  return rules[i];
+}
+
+inline unsigned Maze::Properties(int i) const {
+  assert(0<=i && i<boxCount);
+  return properties[i];
+}
+
+inline int Maze::Start(int pencil) const {
+  assert(0<=pencil && pencil<pencilCount);
+  return start[pencil];
+}
+
+inline int Maze::PencilCount(void) const {
+  return pencilCount;
+}
+
+inline int Maze::FlagCount(void) const {
+  return flagCount;
+}
+
+inline const Maze &Maze::Current(void) {
+  assert(current!=NULL);
+  return *current;
+}
+
+inline int State::IndexBits(void) {
+  return indexBits;
+}
+
+inline int State::Pencils(void) {
+  return pencils;
+}
+
+inline int State::Flags(void) {
+  return flags;
+}
+
+inline int State::GetMazePointIndex(int m) {
+  return Maze::Current().Index(m);
+}
+
+inline State State::FromIndex(long index) {
+  assert(0<=index && (unsigned long)index<=indexMask);
+  State result;
+  result.code = (unsigned long)index;
+  return result;
+}
+
+inline BOOL State::ValidIndexP(long index) {
+  unsigned long boxCount = (unsigned long)Maze::Current().BoxCount();
+  for (int p=0;p<pencils;p++) {
+    if (((index>>pencilShift[p]) & pencilMask)>=boxCount) return FALSE;
+  }
+  return TRUE;
+}
+
+inline long State::BoxStates(void) {
+  return 1L<<(indexBits-pencilBits);
+}
+
+inline long State::IndexWithBox(long i,int p,int box) {
+  assert(0<=i && i<BoxStates() && 0<=p && p<pencils);
+  // make room for the box field of pencil 'p' in the bits of 'i'
+  unsigned long low  = (unsigned long)i & ((1UL<<pencilShift[p])-1);
+  unsigned long high = ((unsigned long)i>>pencilShift[p])<<(pencilShift[p]+pencilBits);
+  return (long)(high | ((unsigned long)box<<pencilShift[p]) | low);
+}
+
+inline int State::Pencil(int p) const {
+#ifndef NDEBUG
+  if (p<0 || pencils<=p) {
+    std::cerr << "State::Pencil(): Illegal pencil index passed";
+    std::cerr << std::endl << std::flush;
+    abort();
+  }
+#endif
+  if (code & illegalBit[p]) {
+    return ILLEGAL_MAZEPOINT;
+  }
+  else if (code & goalBit[p]) {
+    return GOAL_MAZEPOINT;
+  }
+  else {
+    return Maze::Current().Number(BoxIndex(p));
+  }
+}
+
+inline int State::BoxIndex(int p) const {
+  assert(0<=p && p<pencils && !(code & (illegalBit[p] | goalBit[p])));
+  return (int)((code>>pencilShift[p]) & pencilMask);
+}
+
+inline BOOL State::MovementP(int p) const {
+#ifndef NDEBUG
+  if (p<0 || pencils<=p) {
+    std::cerr << "State::MovementP(): Illegal pencil index passed";
+    std::cerr << std::endl << std::flush;
+    abort();
+  }
+#endif
+  return (code>>movedBit[p]) & 1;
+}
+
+inline BOOL State::FlagP(int f) const {
+  assert(0<=f && f<flags);
+  return (code>>f) & 1;
+}
+
+inline BOOL State::Rule60P(void) const {
+  return FlagP(FLAG_RULE60);
+}
+
+inline void State::SetPencil(int p,int x) {
+#ifndef NDEBUG
+  if (p<0 || pencils<=p) {
+    std::cerr << "State::SetPencil(): Illegal pencil index passed";
+    std::cerr << std::endl << std::flush;
+    abort();
+  }
+#endif
+  code &= ~((pencilMask<<pencilShift[p]) | illegalBit[p] | goalBit[p]);
+  if (x==ILLEGAL_MAZEPOINT) {
+    code |= illegalBit[p];
+  }
+  else if (x==GOAL_MAZEPOINT) {
+    code |= goalBit[p];
+  }
+  else {
+    code |= (unsigned long)GetMazePointIndex(x)<<pencilShift[p];
+  }
+}
+
+inline void State::SetMovement(int p,BOOL x) {
+#ifndef NDEBUG
+  if (p<0 || pencils<=p) {
+    std::cerr << "State::SetMovement(): Illegal pencil index passed";
+    std::cerr << std::endl << std::flush;
+    abort();
+  }
+#endif
+  if (x) {
+    code |= 1UL<<movedBit[p];
+  }
+  else {
+    code &= ~(1UL<<movedBit[p]);
+  }
+}
+
+inline void State::SetFlag(int f,BOOL x) {
+  assert(0<=f && f<flags);
+  if (x) {
+    code |= 1UL<<f;
+  }
+  else {
+    code &= ~(1UL<<f);
+  }
+}
+
+inline void State::SetRule60(BOOL x) {
+  SetFlag(FLAG_RULE60,x);
+}
+
+inline BOOL State::IllegalP(void) const {
+  return (code & illegalMask)!=0;
+}
+
+inline BOOL State::GoalP(void) const {
+  return (code & goalMask)!=0;
+}
+
+inline long State::Index(void) const {
+  assert(!IllegalP() && !GoalP());
+  return (long)(code & indexMask);
+}
+
+inline State State::Rotated(int by) const {
+  assert(!IllegalP() && !GoalP());
+  State result;
+  result.code = code & ((1UL<<flags)-1);
+  for (int p=0;p<pencils;p++) {
+    int from = (p+by)%pencils;
+    result.code |= ((code>>pencilShift[from]) & pencilMask)<<pencilShift[p];
+    result.code |= ((code>>movedBit[from]) & 1UL)<<movedBit[p];
+  }
+  return result;
+}
+
+inline void Transition::SetExitPath(int chosenPencil,int path) {
+  assert(0<=chosenPencil && chosenPencil<MAX_PENCILS && PATH_YES<=path && path<=PATH_NONE);
+  exitPath[chosenPencil] = (unsigned char)path;
+}
+
+inline const State &Transition::CurrentState(void) const {
+  return current;
+}
+
+inline State Transition::NextState(int chosenPencil) const {
+#ifndef NDEBUG
+  if (chosenPencil<0 || State::Pencils()<=chosenPencil) {
+    std::cerr << "Transition::NextState(): Illegal pencil index passed";
+    std::cerr << std::endl << std::flush;
+    abort();
+  }
+#endif
+  return Successor(chosenPencil,FALSE);
+}
+
+inline State Transition::AltNextState(int chosenPencil) const {
+#ifndef NDEBUG
+  if (chosenPencil<0 || State::Pencils()<=chosenPencil || exitPath[chosenPencil]!=PATH_LUGNUT) {
+    std::cerr << "Transition::AltNextState(): Illegal pencil index passed";
+    std::cerr << std::endl << std::flush;
+    abort();
+  }
+#endif
+  return Successor(chosenPencil,TRUE);
+}
+
+inline BOOL Transition::AltNextValidP(int chosenPencil) const {
+#ifndef NDEBUG
+  if (chosenPencil<0 || MAX_PENCILS<=chosenPencil) {
+    std::cerr << "Transition::AltNextValidP(): Illegal pencil index passed";
+    std::cerr << std::endl << std::flush;
+    abort();
+  }
+#endif
+  return exitPath[chosenPencil]==PATH_LUGNUT;
+}
+
+inline int Transition::ExitPath(int chosenPencil) const {
+  assert(0<=chosenPencil && chosenPencil<MAX_PENCILS);
+  return exitPath[chosenPencil];
+}
+
+inline EdgeOffset SuccessorGraph::Offset(long index) const {
+  return bases[index/OFFSET_BLOCK]+deltas[index];
+}
+
+inline int SuccessorGraph::Successors(long index,const StateIndex *&first) const {
+  assert(0<=index && index<addedStates);
+  EdgeOffset from = Offset(index);
+  first = successors+from;
+  return (int)(Offset(index+1)-from);
+}
+
+#endif
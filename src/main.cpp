@@ -0,0 +1,366 @@
+// =================================================================================
+// Solution to maze problem in Scientific American, December 1996:
+// Maze with linked nodes, with arcs labeled 'Yes', 'No', and
+// self-referential rules in the boxes. The goal is to put a 'pencil'
+// in box 1 and one in box 7 then reach a 'goal state' with either
+// one of the pencils.
+// =================================================================================
+
+#include "cows.h"
+
+// =================================================================================
+// Set everything in motion
+// =================================================================================
+// Without arguments, the recursive depth-first search is run; it reports every
+// goal it runs into, but only prints the paths of the puzzle's solution depth
+// (37 moves) unless '-alltraces' is given. Other searches are selected with:
+//
+//   -bfs       breadth-first search, which yields a shortest solution
+//   -bidir     bidirectional breadth-first search, from the start forward and
+//              from the goal backward, which also yields a shortest solution
+//   -astar     A* search guided by how far the pencils are from a box with an
+//              exit to the goal, which also yields a shortest solution
+//   -allpairs  instead of solving the puzzle for the start position, determine
+//              the number of moves needed to reach the goal from every possible
+//              start position
+//   -count n   count the distinct shortest solutions and print the first 'n'
+//              of them
+//   -starts f  solve the maze for every start position listed in file 'f' (one
+//              line of start boxes per query) on the same tables
+//   -serve     build the tables once, then keep answering queries (one line of
+//              start boxes each, in batches ended by an empty line) from the
+//              standard input until its end, '-threads n' queries at a time
+//              (see Searcher::StartService())
+//   -listen a  like -serve, but for every client connecting to TCP address
+//              'a': "port" on the loopback interface or "addr:port" (port 0:
+//              any free port, which is printed); up to '-threads n' clients
+//              at once, each on a thread of its own, until stopped (see
+//              Searcher::StartListening())
+//   -bench     instead of searching the maze, time the table builds and the
+//              searches on mazes of different sizes (see "Benchmarks")
+//   -scc       condense the state graph into its strongly connected components,
+//              list the loop traps reachable from the start position and count
+//              the solvable start positions (see "Condensation")
+//   -edit f    solve the maze, then apply the box edits in file 'f' (one "box"
+//              line each) one after the other, updating the tables and the
+//              solution after each (see Searcher::Edit())
+//   -embedded  print the shortest solution of the built-in maze found at compile
+//              time (see "BuiltinSolution"), without building any tables
+//   -oracle    check the tables and the shortest searches against that
+//              compile-time solution (see Searcher::CheckBuiltin())
+//   -visited v breadth-first search without any tables, for state spaces that
+//              do not fit in memory, keeping the visited states as 'v': bits,
+//              layers, disk or auto (see "LeanSearch"); the levels of 'disk'
+//              are written to the directory given by '-spill dir' (default
+//              $TMPDIR or /tmp)
+//
+// With '-csr', the transitions are held in the successor graph (smaller than
+// the transition table with two pencils, not with four; see "SuccessorGraph"),
+// with '-lazy' they are only computed for the states the search actually
+// reaches.
+// With '-prune', the states that cannot be reached or cannot reach the goal are
+// marked first and no search expands them (see Searcher::Prune()).
+// With '-threads n', the tables are built by 'n' threads (0: one per processor),
+// and so is the breadth-first search run. The parallel runs of '-bench' take
+// one thread per processor unless '-threads n' is given ('-threads 1' runs
+// them on a single thread).
+//
+// The built-in maze is the one of the puzzle; '-maze file' reads another one
+// from a maze description file (see "Maze"), '-writemaze' writes the maze in
+// that format and stops. '-compile image' builds the successor graph and writes
+// the maze with it into binary image 'image' (see "MazeImage") before
+// searching; '-image image' searches the maze of an image written so, without
+// building any table. With '-symmetric', states that only differ by a rotation
+// of the pencils are searched once (an image records whether it was compiled
+// so). '-generate boxes[,branching[,seed[,pencils]]]' generates a random maze
+// instead (see Maze::Generate(); by default 70 percent branching, seed 1 and
+// 2 pencils), e.g. to write it with '-writemaze'.
+//
+// After the search, the visited transitions are dumped; '-dump csv' and '-dump
+// binary' select a compact record format instead of the readable one, '-dump
+// none' omits the dump. In a build with COWS_STATS, '-stats file' writes the
+// search statistics (see "SearchStats") to 'file' as JSON at the end.
+// =================================================================================
+
+const int ENGINE_DFS      = 0;
+const int ENGINE_BFS      = 1;
+const int ENGINE_BIDIR    = 2;
+const int ENGINE_ALLPAIRS = 3;
+const int ENGINE_COUNT    = 4;
+const int ENGINE_STARTS   = 5;
+const int ENGINE_BENCH    = 6;
+const int ENGINE_SCC      = 7;
+const int ENGINE_EDIT     = 8;
+const int ENGINE_LEAN     = 9;
+const int ENGINE_ASTAR    = 10;
+const int ENGINE_SERVE    = 11;
+const int ENGINE_EMBEDDED = 12;
+const int ENGINE_ORACLE   = 13;
+
+int main(int argc,char *argv[]) {
+  int         engine    = ENGINE_DFS;
+  int         tableMode = TABLE_DENSE;
+  int         threads   = 1;
+  BOOL        threadsSet = FALSE;
+  BOOL        allTraces  = FALSE;
+  const char *mazeFile  = NULL;
+  const char *imageFile = NULL;
+  const char *compileTo = NULL;
+  BOOL        writeMaze = FALSE;
+  BOOL        symmetric = FALSE;
+  BOOL        prune     = FALSE;
+  int         dump      = DUMP_PRETTY;
+  long        listLimit = 0;
+  const char *startsFile = NULL;
+  const char *editFile   = NULL;
+  const char *listenAddress = NULL;
+  int         visitedMode = VISITED_AUTO;
+  const char *spillDir   = getenv("TMPDIR")!=NULL ? getenv("TMPDIR") : "/tmp";
+  int           genBoxes   = 0;
+  int           genBranch  = 70;
+  unsigned long genSeed  = 1;
+  int           genPencils = 2;
+#ifdef COWS_STATS
+  const char *statsFile  = NULL;
+#endif
+  for (int i=1;i<argc;i++) {
+    if (strcmp(argv[i],"-bfs")==0) {
+      engine = ENGINE_BFS;
+    }
+    else if (strcmp(argv[i],"-bidir")==0) {
+      engine = ENGINE_BIDIR;
+    }
+    else if (strcmp(argv[i],"-astar")==0) {
+      engine = ENGINE_ASTAR;
+    }
+    else if (strcmp(argv[i],"-allpairs")==0) {
+      engine = ENGINE_ALLPAIRS;
+    }
+    else if (strcmp(argv[i],"-count")==0 && i+1<argc) {
+      engine    = ENGINE_COUNT;
+      listLimit = atol(argv[++i]);
+    }
+    else if (strcmp(argv[i],"-bench")==0) {
+      engine = ENGINE_BENCH;
+    }
+    else if (strcmp(argv[i],"-scc")==0) {
+      engine = ENGINE_SCC;
+    }
+    else if (strcmp(argv[i],"-visited")==0 && i+1<argc) {
+      i++;
+      engine = ENGINE_LEAN;
+      if      (strcmp(argv[i],"auto")==0)   visitedMode = VISITED_AUTO;
+      else if (strcmp(argv[i],"bits")==0)   visitedMode = VISITED_BITS;
+      else if (strcmp(argv[i],"layers")==0) visitedMode = VISITED_LAYERS;
+      else if (strcmp(argv[i],"disk")==0)   visitedMode = VISITED_DISK;
+      else {
+        std::cerr << "No such visited set: " << argv[i] << std::endl << std::flush;
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i],"-spill")==0 && i+1<argc) {
+      spillDir = argv[++i];
+    }
+    else if (strcmp(argv[i],"-edit")==0 && i+1<argc) {
+      engine   = ENGINE_EDIT;
+      editFile = argv[++i];
+    }
+    else if (strcmp(argv[i],"-starts")==0 && i+1<argc) {
+      engine     = ENGINE_STARTS;
+      startsFile = argv[++i];
+    }
+    else if (strcmp(argv[i],"-embedded")==0) {
+      engine = ENGINE_EMBEDDED;
+    }
+    else if (strcmp(argv[i],"-oracle")==0) {
+      engine = ENGINE_ORACLE;
+    }
+    else if (strcmp(argv[i],"-serve")==0) {
+      engine = ENGINE_SERVE;
+    }
+    else if (strcmp(argv[i],"-listen")==0 && i+1<argc) {
+      engine     = ENGINE_SERVE;
+      listenAddress = argv[++i];
+    }
+    else if (strcmp(argv[i],"-threads")==0 && i+1<argc) {
+      threads    = atoi(argv[++i]);
+      threadsSet = threads>0;
+      if (threads<=0) threads = (int)std::thread::hardware_concurrency();
+      if (threads<=0) threads = 1;
+    }
+    else if (strcmp(argv[i],"-csr")==0) {
+      tableMode = TABLE_COMPACT;
+    }
+    else if (strcmp(argv[i],"-lazy")==0) {
+      tableMode = TABLE_LAZY;
+    }
+    else if (strcmp(argv[i],"-maze")==0 && i+1<argc) {
+      mazeFile = argv[++i];
+    }
+    else if (strcmp(argv[i],"-generate")==0 && i+1<argc) {
+      if (sscanf(argv[++i],"%d,%d,%lu,%d",&genBoxes,&genBranch,&genSeed,&genPencils)<1 || genBoxes<1) {
+        std::cerr << "-generate: expected boxes[,branching[,seed[,pencils]]]" << std::endl << std::flush;
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i],"-image")==0 && i+1<argc) {
+      imageFile = argv[++i];
+    }
+    else if (strcmp(argv[i],"-compile")==0 && i+1<argc) {
+      compileTo = argv[++i];
+      tableMode = TABLE_COMPACT;
+    }
+    else if (strcmp(argv[i],"-writemaze")==0) {
+      writeMaze = TRUE;
+    }
+    else if (strcmp(argv[i],"-prune")==0) {
+      prune = TRUE;
+    }
+    else if (strcmp(argv[i],"-symmetric")==0) {
+      symmetric = TRUE;
+    }
+    else if (strcmp(argv[i],"-alltraces")==0) {
+      allTraces = TRUE;
+    }
+    else if (strcmp(argv[i],"-stats")==0 && i+1<argc) {
+#ifdef COWS_STATS
+      statsFile = argv[++i];
+#else
+      std::cerr << "-stats: compiled without COWS_STATS" << std::endl << std::flush;
+      return 1;
+#endif
+    }
+    else if (strcmp(argv[i],"-dump")==0 && i+1<argc) {
+      i++;
+      if (strcmp(argv[i],"pretty")==0)      dump = DUMP_PRETTY;
+      else if (strcmp(argv[i],"csv")==0)    dump = DUMP_CSV;
+      else if (strcmp(argv[i],"binary")==0) dump = DUMP_BINARY;
+      else if (strcmp(argv[i],"none")==0)   dump = DUMP_NONE;
+      else {
+        std::cerr << "No such dump format: " << argv[i] << std::endl << std::flush;
+        return 1;
+      }
+    }
+    else {
+      std::cerr << "Usage: " << argv[0] << " [-bfs|-bidir|-astar|-allpairs|-count n|-starts file|-serve|-listen [addr:]port|-bench|-scc|-edit file|-embedded|-oracle|-visited auto|bits|layers|disk] [-spill dir] [-csr|-lazy] [-threads n]"
+                << " [-maze file|-image image|-generate boxes[,branching[,seed[,pencils]]]] [-compile image] [-writemaze] [-symmetric] [-prune] [-alltraces]"
+                << " [-dump pretty|csv|binary|none] [-stats file]" << std::endl << std::flush;
+      return 1;
+    }
+  }
+  if (engine==ENGINE_BENCH) {
+    // the parallel runs take one thread per processor unless told otherwise
+    if (!threadsSet) threads = (int)std::thread::hardware_concurrency();
+    RunBenchmarks(threads>0 ? threads : 1);
+    return 0;
+  }
+  if (engine==ENGINE_EDIT && imageFile!=NULL) {
+    // the maze of an image is read-only, and so is its successor graph
+    std::cerr << "-edit: cannot edit the maze of an image" << std::endl << std::flush;
+    return 1;
+  }
+  Maze      maze;
+  MazeImage image;
+  Searcher *x;
+  if (imageFile!=NULL) {
+    if (!image.Open(imageFile,std::cerr)) return 1;
+    Maze::Install(image.GetMaze());
+  }
+  else {
+    if (mazeFile!=NULL && !maze.Load(mazeFile,std::cerr)) return 1;
+    if (genBoxes>0 && !maze.Generate(genBoxes,genBranch,genSeed,genPencils,std::cerr)) return 1;
+    Maze::Install(maze);
+  }
+  if (writeMaze) {
+    Maze::Current().Write(std::cout);
+    return 0;
+  }
+  if (engine==ENGINE_EMBEDDED) {
+    return PrintBuiltinSolution(std::cout) ? 0 : 1;
+  }
+  if (imageFile!=NULL) {
+    x = new Searcher(image.NewGraph(),threads,image.Symmetric());
+  }
+  else {
+    // the search without tables only needs the transitions computed on the fly
+    if (engine==ENGINE_LEAN) tableMode = TABLE_LAZY;
+    x = new Searcher(tableMode,threads,symmetric);
+  }
+  if (compileTo!=NULL && !x->WriteImage(compileTo)) {
+    delete x;
+    return 1;
+  }
+  if (prune) x->Prune();
+  switch (engine) {
+  case ENGINE_ALLPAIRS:
+    x->StartAllPairsSweep();
+    dump = DUMP_NONE;
+    break;
+  case ENGINE_SCC:
+    x->StartCondensation();
+    dump = DUMP_NONE;
+    break;
+  case ENGINE_BIDIR:
+    x->StartBidirectionalTraversal();
+    break;
+  case ENGINE_ASTAR:
+    x->StartAStarTraversal();
+    break;
+  case ENGINE_BFS:
+    x->StartBfsTraversal();
+    break;
+  case ENGINE_COUNT:
+    x->StartCounting(listLimit);
+    break;
+  case ENGINE_STARTS:
+    if (!x->StartQueries(startsFile)) {
+      delete x;
+      return 1;
+    }
+    break;
+  case ENGINE_ORACLE:
+    if (!x->CheckBuiltin()) {
+      delete x;
+      return 1;
+    }
+    dump = DUMP_NONE;
+    break;
+  case ENGINE_SERVE:
+    if (listenAddress!=NULL ? !x->StartListening(listenAddress) : !x->StartService(std::cin,std::cout)) {
+      delete x;
+      return 1;
+    }
+    dump = DUMP_NONE;
+    break;
+  case ENGINE_EDIT:
+    if (!x->StartEditing(maze,editFile)) {
+      delete x;
+      return 1;
+    }
+    dump = DUMP_NONE;
+    break;
+  case ENGINE_LEAN:
+    if (!x->StartLeanSearch(visitedMode,spillDir)) {
+      delete x;
+      return 1;
+    }
+    dump = DUMP_NONE;
+    break;
+  default:
+    x->StartTraversal(allTraces);
+  }
+  x->DumpTransitions(std::cout,dump);
+#ifdef COWS_STATS
+  if (statsFile!=NULL) {
+    std::ofstream os(statsFile);
+    x->Stats().WriteJson(os);
+    if (!os) {
+      std::cerr << statsFile << ": Cannot write the statistics" << std::endl << std::flush;
+      delete x;
+      return 1;
+    }
+  }
+#endif
+  delete x;
+  return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/sh
+# =================================================================================
+# Checks of the searches of cows, run by "make check" (or "sh tests/check.sh
+# path/to/cows"):
+# - the tables and the shortest searches against the compile-time solution of
+#   the built-in maze (-oracle), in every table mode
+# - every engine, visited set and table mode finds the shortest solution of the
+#   built-in maze at depth 37
+# - on generated mazes (one with 3 pencils, one without a solution), every
+#   engine finds the depth the breadth-first search finds
+# Prints a line per check and exits with 1 if any of them fails.
+# =================================================================================
+
+cows=${1:-./cows}
+failed=0
+
+# the depth of the first solution printed ("..., depth N"), empty if none
+depth() {
+  "$cows" "$@" -dump none 2>/dev/null | sed -n 's/.*depth \([0-9]*\).*/\1/p' | head -1
+}
+
+report() {
+  if [ "$1" = "$2" ]; then
+    echo "ok    $3"
+  else
+    echo "FAIL  $3: got ${1:-nothing}, expected ${2:-nothing}"
+    failed=1
+  fi
+}
+
+for mode in "" "-csr" "-lazy" "-symmetric" "-threads 4"; do
+  if "$cows" -oracle $mode >/dev/null 2>&1; then result=passed; else result=failed; fi
+  report $result passed "-oracle${mode:+ $mode}"
+done
+
+for engine in "" "-csr" "-lazy" "-bfs" "-bfs -csr" "-bfs -lazy" "-bfs -threads 4" \
+              "-bfs -symmetric" "-bfs -prune" "-bidir" "-bidir -csr" "-astar" "-astar -csr" \
+              "-count 1" "-visited bits" "-visited layers" "-visited disk" "-visited auto"; do
+  report "$(depth $engine)" 37 "built-in maze, ${engine:-dfs}: depth 37"
+done
+
+for maze in 1000,70,4 300,70,7 40,70,7,3 40,70,2,3; do
+  expected=$(depth -generate $maze -bfs)
+  for engine in "-bfs -csr" "-bfs -lazy" "-bfs -threads 4" "-bfs -symmetric" "-bidir" "-astar" \
+                "-count 0" "-visited bits" "-visited layers" "-visited disk"; do
+    report "$(depth -generate $maze $engine)" "$expected" "-generate $maze, $engine: depth ${expected:-none} as -bfs"
+  done
+done
+
+exit $failed